@@ -0,0 +1,138 @@
+// Allocation checks for steady-state frames.
+//
+//   --arena=KB             serve nuklear's per-frame memory from a KB sized
+//                          arena allocated at startup (see nk_sdl_set_arena)
+//   --check-allocs[=N]     after N warm-up frames (default 60), log every
+//                          rendered frame that allocates; headless runs then
+//                          exit with status 1 if any frame did
+//
+// Counted are nuklear's allocations through the SDL backend, SDL's own through
+// SDL_SetMemoryFunctions and, in debug builds, C++ operator new. Malloc calls
+// from other libraries are not seen. Tracing allocates for its buffers, so
+// leave --trace off for the check.
+//
+// `--headless --arena=4096 --check-allocs` is the regression test: a steady
+// frame must not allocate.
+
+#include <atomic>
+#include <new>
+
+#define ALLOC_CHECK_DEFAULT_WARMUP 60
+
+struct AllocCheck {
+    bool enabled = false;
+    int warmup = ALLOC_CHECK_DEFAULT_WARMUP;
+    size_t arena_kb = 0;
+    int frame = 0;
+    unsigned long sdl_start = 0, new_start = 0;
+    unsigned long failed_frames = 0;
+};
+
+static AllocCheck alloc_check;
+static std::atomic<unsigned long> alloc_sdl_count(0);
+static std::atomic<unsigned long> alloc_new_count(0);
+
+#ifndef NDEBUG
+void* operator new(size_t size)
+{
+    alloc_new_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { free(ptr); }
+#endif
+
+static SDL_malloc_func alloc_sdl_malloc;
+static SDL_calloc_func alloc_sdl_calloc;
+static SDL_realloc_func alloc_sdl_realloc;
+static SDL_free_func alloc_sdl_free;
+
+static void* SDLCALL AllocCountMalloc(size_t size)
+{
+    alloc_sdl_count.fetch_add(1, std::memory_order_relaxed);
+    return alloc_sdl_malloc(size);
+}
+
+static void* SDLCALL AllocCountCalloc(size_t count, size_t size)
+{
+    alloc_sdl_count.fetch_add(1, std::memory_order_relaxed);
+    return alloc_sdl_calloc(count, size);
+}
+
+static void* SDLCALL AllocCountRealloc(void* ptr, size_t size)
+{
+    alloc_sdl_count.fetch_add(1, std::memory_order_relaxed);
+    return alloc_sdl_realloc(ptr, size);
+}
+
+// Parses the options and hooks SDL's allocator, so it has to run before
+// anything else calls into SDL. Returns false if an option has an invalid value.
+bool ParseAllocArgs(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--check-allocs") == 0) {
+            alloc_check.enabled = true;
+        } else if (strncmp(argv[i], "--check-allocs=", 15) == 0) {
+            alloc_check.enabled = true;
+            alloc_check.warmup = atoi(argv[i] + 15);
+            if (alloc_check.warmup < 0) {
+                SDL_Log("allocs: invalid warm-up frame count '%s'", argv[i] + 15);
+                return false;
+            }
+        } else if (strncmp(argv[i], "--arena=", 8) == 0) {
+            int kb = atoi(argv[i] + 8);
+            if (kb <= 0) {
+                SDL_Log("allocs: invalid arena size '%s'", argv[i] + 8);
+                return false;
+            }
+            alloc_check.arena_kb = (size_t)kb;
+        }
+    }
+    if (alloc_check.enabled) {
+        SDL_GetMemoryFunctions(&alloc_sdl_malloc, &alloc_sdl_calloc, &alloc_sdl_realloc, &alloc_sdl_free);
+        SDL_SetMemoryFunctions(AllocCountMalloc, AllocCountCalloc, AllocCountRealloc, alloc_sdl_free);
+    }
+    return true;
+}
+
+// Call once per rendered frame, after it has been presented.
+void AllocCheckEndFrame()
+{
+    if (!alloc_check.enabled)
+        return;
+    struct nk_sdl_memory_stats stats[NK_SDL_MEMORY_COUNT];
+    nk_sdl_memory_stats(stats);
+    unsigned long nk_allocs = 0;
+    for (int i = 0; i < NK_SDL_MEMORY_COUNT; i++)
+        nk_allocs += stats[i].frame_allocs;
+    unsigned long sdl_allocs = alloc_sdl_count.load(std::memory_order_relaxed) - alloc_check.sdl_start;
+    unsigned long new_allocs = alloc_new_count.load(std::memory_order_relaxed) - alloc_check.new_start;
+
+    if (alloc_check.frame++ >= alloc_check.warmup && (nk_allocs || sdl_allocs || new_allocs)) {
+        alloc_check.failed_frames++;
+        SDL_Log("allocs: frame %d allocated: nuklear %lu, SDL %lu, operator new %lu",
+            alloc_check.frame, nk_allocs, sdl_allocs, new_allocs);
+    }
+    // the log above may allocate itself, so the next frame starts from here
+    alloc_check.sdl_start = alloc_sdl_count.load(std::memory_order_relaxed);
+    alloc_check.new_start = alloc_new_count.load(std::memory_order_relaxed);
+}
+
+// Logs the result. Returns false if a frame after the warm-up allocated.
+bool AllocCheckReport()
+{
+    if (!alloc_check.enabled)
+        return true;
+    struct nk_sdl_arena_stats arena;
+    nk_sdl_arena_stats(&arena);
+    if (arena.size)
+        SDL_Log("allocs: arena peak %lu of %lu bytes, %lu overflows", (unsigned long)arena.peak, (unsigned long)arena.size, arena.overflows);
+    int checked = alloc_check.frame > alloc_check.warmup ? alloc_check.frame - alloc_check.warmup : 0;
+    SDL_Log("allocs: %lu of %d steady frames allocated", alloc_check.failed_frames, checked);
+    return alloc_check.failed_frames == 0;
+}
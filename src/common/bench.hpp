@@ -0,0 +1,140 @@
+// Color tuple parser benchmark.
+//
+//   --bench-parse          parses every tuple of the themes in themes/ and exits
+//   --bench-parse=N        the same with N rounds instead of BENCH_DEFAULT_ROUNDS
+//
+// Times ParseColorTuple() against the std::regex and istringstream parser it
+// replaced, kept here as BenchExtractNumbers(), on the [theme] colors and the
+// [background] bg of the shipped themes. Both have to produce the same values
+// for every tuple, else the run fails. Runs before SDL is initialized, like
+// --convert, so it can be rerun in CI to catch regressions.
+
+#include <regex>
+
+#define BENCH_DEFAULT_ROUNDS 200
+
+// The parser of loadTheme() before ParseColorTuple(), for comparison only.
+template<typename T>
+static std::vector<T> BenchExtractNumbers(const std::string& input) {
+    std::regex separator("[\\s,]+");
+    std::sregex_token_iterator it(input.begin(), input.end(), separator, -1);
+    std::sregex_token_iterator end;
+
+    std::vector<T> numbers;
+    for (; it != end; ++it) {
+        std::istringstream iss(*it);
+        T number;
+        if (iss >> std::boolalpha >> number)
+            numbers.push_back(number);
+    }
+
+    return numbers;
+}
+
+struct BenchTuples {
+    std::vector<std::string> colors;    // "r, g, b, a" as ints
+    std::vector<std::string> bgs;       // "r, g, b, a" as floats
+};
+
+static bool BenchLoad(const char* dir, BenchTuples& tuples)
+{
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() != ".ini")
+            continue;
+        portini::Document doc;
+        if (!doc.ParseFromFile(it->path().string().c_str())) {
+            SDL_Log("bench: skipping %s, it does not parse", it->path().string().c_str());
+            continue;
+        }
+        if (doc.HasSection("theme")) {
+            for (auto& key : doc.GetSection("theme"))
+                tuples.colors.push_back(key.second.GetValue());
+        }
+        if (doc.HasSection("background") && doc.GetSection("background").HasKey("bg"))
+            tuples.bgs.push_back(doc.GetSection("background").GetKey("bg").GetValue());
+    }
+    return !tuples.colors.empty();
+}
+
+// Both parsers read the same values; ParseColorTuple() is not range checked
+// here, as ExtractNumbers() never was.
+template<typename T>
+static bool BenchSameValues(const std::string& tuple)
+{
+    std::vector<T> old_values = BenchExtractNumbers<T>(tuple);
+    ColorTuple<T> values = ParseColorTuple<T>(tuple, 0, T(), T(), 0);
+    if (values.error || (int)old_values.size() != values.count)
+        return false;
+    for (int i = 0; i < values.count; i++) {
+        if (old_values[i] != values.values[i])
+            return false;
+    }
+    return true;
+}
+
+// Nanoseconds per tuple of `parse` over all tuples, `rounds` times.
+template<typename F>
+static double BenchTime(const BenchTuples& tuples, int rounds, F parse)
+{
+    double sink = 0;
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int round = 0; round < rounds; round++) {
+        for (const std::string& tuple : tuples.colors)
+            sink += parse(tuple, 0);
+        for (const std::string& tuple : tuples.bgs)
+            sink += parse(tuple, 1);
+    }
+    double ns = (SDL_GetPerformanceCounter() - start) * 1e9 / SDL_GetPerformanceFrequency();
+    volatile double keep = sink;        // the results must not be optimized away
+    (void)keep;
+    return ns / ((double)rounds * (tuples.colors.size() + tuples.bgs.size()));
+}
+
+// Returns -1 if --bench-parse is not given, else the exit code of the run.
+int ParseBenchArgs(int argc, char* argv[])
+{
+    int rounds = -1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench-parse") == 0) {
+            rounds = BENCH_DEFAULT_ROUNDS;
+        } else if (strncmp(argv[i], "--bench-parse=", 14) == 0) {
+            rounds = atoi(argv[i] + 14);
+            if (rounds <= 0) {
+                SDL_Log("bench: invalid round count '%s'", argv[i] + 14);
+                return 1;
+            }
+        }
+    }
+    if (rounds < 0)
+        return -1;
+
+    BenchTuples tuples;
+    if (!BenchLoad("themes", tuples)) {
+        SDL_Log("bench: no themes found in themes/");
+        return 1;
+    }
+    for (const std::string& tuple : tuples.colors) {
+        if (!BenchSameValues<int>(tuple)) {
+            SDL_Log("bench: parsers disagree on '%s'", tuple.c_str());
+            return 1;
+        }
+    }
+    for (const std::string& tuple : tuples.bgs) {
+        if (!BenchSameValues<float>(tuple)) {
+            SDL_Log("bench: parsers disagree on '%s'", tuple.c_str());
+            return 1;
+        }
+    }
+
+    double old_ns = BenchTime(tuples, rounds, [](const std::string& tuple, int bg) {
+        return bg ? (double)BenchExtractNumbers<float>(tuple).size() : (double)BenchExtractNumbers<int>(tuple).size();
+    });
+    double new_ns = BenchTime(tuples, rounds, [](const std::string& tuple, int bg) {
+        return bg ? (double)ParseColorTuple<float>(tuple, 3, -0.1f, 1.1f, 3).count : (double)ParseColorTuple<int>(tuple, 4, 0, 255).count;
+    });
+    SDL_Log("bench: %d color and %d bg tuples, %d rounds", (int)tuples.colors.size(), (int)tuples.bgs.size(), rounds);
+    SDL_Log("bench: ExtractNumbers (regex + istringstream) %10.1f ns/tuple", old_ns);
+    SDL_Log("bench: ParseColorTuple (from_chars)           %10.1f ns/tuple", new_ns);
+    return 0;
+}
@@ -0,0 +1,536 @@
+// Theme browser.
+//
+// Shows the themes of the library (see common/library.hpp) as a grid of
+// preview thumbnails. A click applies a theme straight from the index, so
+// nothing is parsed. A thumbnail is a fixed widget scene (a window with
+// buttons, toggles, slider, progress bar, edit field and chart) laid out by a
+// private nuklear context under the theme. A worker thread rasterizes its
+// draw commands into memory, so neither the GPU nor the main context is
+// involved. Text is drawn as bars, so the scene needs no font.
+//
+// Thumbnails are kept in thumbnails/ under a hash of the palette, so a theme
+// is rendered once, whatever its file is called. They are copied into a
+// single atlas texture and the grid draws as one batch. When the library is
+// rescanned, by the Rescan button or the hot reload watcher, thumbnails whose
+// palette did not change are kept and only new or edited themes are rendered.
+
+#include <condition_variable>
+
+#define BROWSER_SCENE_W 256
+#define BROWSER_SCENE_H 224
+#define BROWSER_THUMB_W (BROWSER_SCENE_W / 2)   // the scene is downsampled 2x2
+#define BROWSER_THUMB_H (BROWSER_SCENE_H / 2)
+#define BROWSER_ATLAS_COLUMNS 16
+#define BROWSER_CACHE_DIR "thumbnails"
+#define BROWSER_SCENE_VERSION 1                 // bump when the scene changes, invalidates the disk cache
+
+struct BrowserJob {
+    unsigned int generation;
+    int slot;
+    Uint64 hash;
+    struct nk_color colors[NK_COLOR_COUNT];
+    struct nk_colorf bg;
+};
+
+struct BrowserResult {
+    unsigned int generation;
+    int slot;
+    bool from_disk;
+    std::vector<Uint32> pixels;         // ARGB8888, BROWSER_THUMB_W x BROWSER_THUMB_H
+};
+
+struct BrowserSlot {
+    int entry;                          // index into Browser::entries
+    Uint64 hash;
+    bool ready = false;
+    std::vector<Uint32> pixels;
+};
+
+struct Browser {
+    std::thread worker;
+    std::mutex mutex;                   // guards jobs, results, generation and quit
+    std::condition_variable wake;
+    std::vector<BrowserJob> jobs;       // taken from the back
+    std::vector<BrowserResult> results;
+    unsigned int generation = 0;        // results of older generations are dropped
+    bool quit = false;
+
+    // main thread only
+    std::vector<ThemeEntry> entries;
+    unsigned int library_version = 0;
+    LibraryStats library_stats;
+    std::vector<BrowserSlot> slots;     // one per valid theme, in atlas order
+    int pending = 0;                    // slots still waiting for their thumbnail
+    int rendered = 0;
+    int from_disk = 0;
+    SDL_Texture* atlas = NULL;
+    int atlas_capacity = 0;
+};
+
+static Browser browser;
+
+// Software rasterizer for the scene, opaque target, no anti-aliasing.
+struct BrowserCanvas {
+    Uint32* pixels;
+    int x0, y0, x1, y1;                 // clip rect, exclusive end
+};
+
+static void BrowserBlend(Uint32& dst, struct nk_color c)
+{
+    unsigned int a = c.a, ia = 255 - a;
+    unsigned int r = (c.r * a + ((dst >> 16) & 0xff) * ia) / 255;
+    unsigned int g = (c.g * a + ((dst >> 8) & 0xff) * ia) / 255;
+    unsigned int b = (c.b * a + (dst & 0xff) * ia) / 255;
+    dst = 0xff000000u | (r << 16) | (g << 8) | b;
+}
+
+static void BrowserFillRect(BrowserCanvas& cv, int x, int y, int w, int h, struct nk_color c)
+{
+    int x0 = std::max(x, cv.x0), y0 = std::max(y, cv.y0);
+    int x1 = std::min(x + w, cv.x1), y1 = std::min(y + h, cv.y1);
+    for (int py = y0; py < y1; py++) {
+        for (int px = x0; px < x1; px++)
+            BrowserBlend(cv.pixels[py * BROWSER_SCENE_W + px], c);
+    }
+}
+
+static void BrowserStrokeRect(BrowserCanvas& cv, int x, int y, int w, int h, int t, struct nk_color c)
+{
+    t = std::max(t, 1);
+    BrowserFillRect(cv, x, y, w, t, c);
+    BrowserFillRect(cv, x, y + h - t, w, t, c);
+    BrowserFillRect(cv, x, y + t, t, h - 2 * t, c);
+    BrowserFillRect(cv, x + w - t, y + t, t, h - 2 * t, c);
+}
+
+static void BrowserFillEllipse(BrowserCanvas& cv, int x, int y, int w, int h, struct nk_color c)
+{
+    float rx = w * 0.5f, ry = h * 0.5f, cx = x + rx, cy = y + ry;
+    if (rx <= 0 || ry <= 0)
+        return;
+    for (int py = std::max(y, cv.y0); py < std::min(y + h, cv.y1); py++) {
+        for (int px = std::max(x, cv.x0); px < std::min(x + w, cv.x1); px++) {
+            float dx = (px + 0.5f - cx) / rx, dy = (py + 0.5f - cy) / ry;
+            if (dx * dx + dy * dy <= 1.0f)
+                BrowserBlend(cv.pixels[py * BROWSER_SCENE_W + px], c);
+        }
+    }
+}
+
+static void BrowserLine(BrowserCanvas& cv, struct nk_vec2i a, struct nk_vec2i b, struct nk_color c)
+{
+    int steps = std::max(std::abs(b.x - a.x), std::abs(b.y - a.y));
+    for (int i = 0; i <= steps; i++) {
+        float t = steps ? (float)i / steps : 0.0f;
+        BrowserFillRect(cv, (int)(a.x + (b.x - a.x) * t), (int)(a.y + (b.y - a.y) * t), 1, 1, c);
+    }
+}
+
+static void BrowserFillTriangle(BrowserCanvas& cv, struct nk_vec2i a, struct nk_vec2i b, struct nk_vec2i c, struct nk_color color)
+{
+    auto edge = [](struct nk_vec2i p, struct nk_vec2i q, float x, float y) {
+        return (q.x - p.x) * (y - p.y) - (q.y - p.y) * (x - p.x);
+    };
+    float area = edge(a, b, (float)c.x, (float)c.y);
+    if (area == 0)
+        return;
+    int x0 = std::max((int)std::min({ a.x, b.x, c.x }), cv.x0), x1 = std::min(std::max({ a.x, b.x, c.x }) + 1, cv.x1);
+    int y0 = std::max((int)std::min({ a.y, b.y, c.y }), cv.y0), y1 = std::min(std::max({ a.y, b.y, c.y }) + 1, cv.y1);
+    for (int py = y0; py < y1; py++) {
+        for (int px = x0; px < x1; px++) {
+            float x = px + 0.5f, y = py + 0.5f;
+            float w0 = edge(b, c, x, y) / area, w1 = edge(c, a, x, y) / area, w2 = edge(a, b, x, y) / area;
+            if (w0 >= 0 && w1 >= 0 && w2 >= 0)
+                BrowserBlend(cv.pixels[py * BROWSER_SCENE_W + px], color);
+        }
+    }
+}
+
+static float BrowserTextWidth(nk_handle, float height, const char*, int len)
+{
+    return len * height * 0.55f;
+}
+
+// Lays out the scene under the theme and draws it into `scene`.
+static void BrowserDrawScene(struct nk_context* ctx, const BrowserJob& job, std::vector<Uint32>& scene)
+{
+    nk_style_from_table(ctx, job.colors);
+    if (nk_begin(ctx, "Preview", nk_rect(8, 8, BROWSER_SCENE_W - 16, BROWSER_SCENE_H - 16), NK_WINDOW_BORDER | NK_WINDOW_TITLE | NK_WINDOW_NO_SCROLLBAR)) {
+        nk_layout_row_dynamic(ctx, 20, 2);
+        nk_button_label(ctx, "Button");
+        nk_button_label(ctx, "Cancel");
+        nk_layout_row_dynamic(ctx, 16, 2);
+        int check = nk_true;
+        nk_checkbox_label(ctx, "Check", &check);
+        nk_option_label(ctx, "Option", nk_true);
+        nk_layout_row_dynamic(ctx, 16, 1);
+        float slider = 0.6f;
+        nk_slider_float(ctx, 0, &slider, 1, 0.1f);
+        nk_size progress = 40;
+        nk_progress(ctx, &progress, 100, nk_false);
+        nk_layout_row_dynamic(ctx, 20, 1);
+        char text[] = "Edit";
+        nk_edit_string_zero_terminated(ctx, NK_EDIT_FIELD, text, sizeof(text), nk_filter_default);
+        nk_layout_row_dynamic(ctx, 40, 1);
+        static const float values[] = { 0.2f, 0.5f, 0.35f, 0.8f, 0.6f, 0.9f, 0.4f };
+        if (nk_chart_begin(ctx, NK_CHART_LINES, 7, 0, 1)) {
+            for (float value : values)
+                nk_chart_push(ctx, value);
+            nk_chart_end(ctx);
+        }
+    }
+    nk_end(ctx);
+
+    Uint32 background = 0xff000000u;
+    background |= (Uint32)(NK_SATURATE(job.bg.r) * 255) << 16;
+    background |= (Uint32)(NK_SATURATE(job.bg.g) * 255) << 8;
+    background |= (Uint32)(NK_SATURATE(job.bg.b) * 255);
+    std::fill(scene.begin(), scene.end(), background);
+    BrowserCanvas cv = { scene.data(), 0, 0, BROWSER_SCENE_W, BROWSER_SCENE_H };
+    const struct nk_command* cmd;
+    nk_foreach(cmd, ctx) {
+        switch (cmd->type) {
+        case NK_COMMAND_SCISSOR: {
+            const struct nk_command_scissor* s = (const struct nk_command_scissor*)cmd;
+            cv.x0 = std::max(0, (int)s->x);
+            cv.y0 = std::max(0, (int)s->y);
+            cv.x1 = std::min(BROWSER_SCENE_W, s->x + (int)s->w);
+            cv.y1 = std::min(BROWSER_SCENE_H, s->y + (int)s->h);
+        } break;
+        case NK_COMMAND_RECT_FILLED: {
+            const struct nk_command_rect_filled* r = (const struct nk_command_rect_filled*)cmd;
+            BrowserFillRect(cv, r->x, r->y, r->w, r->h, r->color);
+        } break;
+        case NK_COMMAND_RECT: {
+            const struct nk_command_rect* r = (const struct nk_command_rect*)cmd;
+            BrowserStrokeRect(cv, r->x, r->y, r->w, r->h, r->line_thickness, r->color);
+        } break;
+        case NK_COMMAND_CIRCLE_FILLED: {
+            const struct nk_command_circle_filled* c = (const struct nk_command_circle_filled*)cmd;
+            BrowserFillEllipse(cv, c->x, c->y, c->w, c->h, c->color);
+        } break;
+        case NK_COMMAND_LINE: {
+            const struct nk_command_line* l = (const struct nk_command_line*)cmd;
+            BrowserLine(cv, l->begin, l->end, l->color);
+        } break;
+        case NK_COMMAND_TRIANGLE_FILLED: {
+            const struct nk_command_triangle_filled* t = (const struct nk_command_triangle_filled*)cmd;
+            BrowserFillTriangle(cv, t->a, t->b, t->c, t->color);
+        } break;
+        case NK_COMMAND_TEXT: {
+            // a bar over the middle half of the line
+            const struct nk_command_text* t = (const struct nk_command_text*)cmd;
+            int w = std::min((int)t->w, (int)BrowserTextWidth(t->font->userdata, t->height, t->string, t->length));
+            BrowserFillRect(cv, t->x, t->y + (int)(t->height * 0.25f), w, std::max(1, (int)(t->height * 0.5f)), t->foreground);
+        } break;
+        default:
+            break;
+        }
+    }
+    nk_clear(ctx);
+}
+
+static void BrowserDownsample(const std::vector<Uint32>& scene, std::vector<Uint32>& thumb)
+{
+    thumb.resize(BROWSER_THUMB_W * BROWSER_THUMB_H);
+    for (int y = 0; y < BROWSER_THUMB_H; y++) {
+        for (int x = 0; x < BROWSER_THUMB_W; x++) {
+            const Uint32* p = &scene[(y * 2) * BROWSER_SCENE_W + x * 2];
+            Uint32 q[4] = { p[0], p[1], p[BROWSER_SCENE_W], p[BROWSER_SCENE_W + 1] };
+            Uint32 out = 0xff000000u;
+            for (int shift = 0; shift < 24; shift += 8) {
+                Uint32 sum = 0;
+                for (Uint32 v : q)
+                    sum += (v >> shift) & 0xff;
+                out |= ((sum + 2) / 4) << shift;
+            }
+            thumb[y * BROWSER_THUMB_W + x] = out;
+        }
+    }
+}
+
+static std::string BrowserCachePath(Uint64 hash)
+{
+    char name[64];
+    snprintf(name, sizeof(name), BROWSER_CACHE_DIR "/%016llx.thumb", (unsigned long long)hash);
+    return name;
+}
+
+static bool BrowserLoadThumbnail(Uint64 hash, std::vector<Uint32>& pixels)
+{
+    std::ifstream in(BrowserCachePath(hash), std::ios_base::binary);
+    Uint32 header[3];
+    if (!in.read((char*)header, sizeof(header)) || header[0] != BROWSER_SCENE_VERSION ||
+        header[1] != BROWSER_THUMB_W || header[2] != BROWSER_THUMB_H)
+        return false;
+    pixels.resize(BROWSER_THUMB_W * BROWSER_THUMB_H);
+    return (bool)in.read((char*)pixels.data(), pixels.size() * sizeof(Uint32));
+}
+
+static void BrowserSaveThumbnail(Uint64 hash, const std::vector<Uint32>& pixels)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(BROWSER_CACHE_DIR, ec);
+    std::ofstream out(BrowserCachePath(hash), std::ios_base::binary);
+    Uint32 header[3] = { BROWSER_SCENE_VERSION, BROWSER_THUMB_W, BROWSER_THUMB_H };
+    out.write((const char*)header, sizeof(header));
+    out.write((const char*)pixels.data(), pixels.size() * sizeof(Uint32));
+}
+
+static void BrowserWorkerLoop()
+{
+    TraceThreadName("thumbnails");
+    struct nk_user_font font;
+    font.userdata = nk_handle_ptr(NULL);
+    font.height = 10;
+    font.width = BrowserTextWidth;
+    struct nk_context ctx;
+    nk_init_default(&ctx, &font);
+    std::vector<Uint32> scene(BROWSER_SCENE_W * BROWSER_SCENE_H);
+
+    std::unique_lock<std::mutex> lock(browser.mutex);
+    for (;;) {
+        browser.wake.wait(lock, [] { return browser.quit || !browser.jobs.empty(); });
+        if (browser.quit)
+            break;
+        BrowserJob job = browser.jobs.back();
+        browser.jobs.pop_back();
+        lock.unlock();
+
+        BrowserResult result;
+        result.generation = job.generation;
+        result.slot = job.slot;
+        result.from_disk = BrowserLoadThumbnail(job.hash, result.pixels);
+        if (!result.from_disk) {
+            TRACE_SCOPE("thumbnail");
+            BrowserDrawScene(&ctx, job, scene);
+            BrowserDownsample(scene, result.pixels);
+            BrowserSaveThumbnail(job.hash, result.pixels);
+        }
+
+        lock.lock();
+        browser.results.push_back(std::move(result));
+    }
+    lock.unlock();
+    nk_free(&ctx);
+}
+
+static Uint64 BrowserHash(const ThemeEntry& entry)
+{
+    Uint64 hash = 14695981039346656037ull;
+    auto mix = [&hash](const void* data, size_t size) {
+        for (size_t i = 0; i < size; i++)
+            hash = (hash ^ ((const unsigned char*)data)[i]) * 1099511628211ull;
+    };
+    int version = BROWSER_SCENE_VERSION;
+    mix(&version, sizeof(version));
+    mix(entry.colors, sizeof(entry.colors));
+    mix(&entry.bg, sizeof(entry.bg));
+    return hash;
+}
+
+static void BrowserUpload(int slot)
+{
+    const BrowserSlot& s = browser.slots[slot];
+    if (!browser.atlas || slot >= browser.atlas_capacity || !s.ready)
+        return;
+    SDL_Rect rect = { (slot % BROWSER_ATLAS_COLUMNS) * BROWSER_THUMB_W, (slot / BROWSER_ATLAS_COLUMNS) * BROWSER_THUMB_H,
+        BROWSER_THUMB_W, BROWSER_THUMB_H };
+    SDL_UpdateTexture(browser.atlas, &rect, s.pixels.data(), BROWSER_THUMB_W * sizeof(Uint32));
+}
+
+// Makes room for `count` thumbnails, as far as the renderer allows.
+static void BrowserReserveAtlas(SDL_Renderer* renderer, int count)
+{
+    if (count <= browser.atlas_capacity)
+        return;
+    SDL_RendererInfo info;
+    int max_height = SDL_GetRendererInfo(renderer, &info) == 0 && info.max_texture_height ? info.max_texture_height : 4096;
+    int rows = (count + BROWSER_ATLAS_COLUMNS - 1) / BROWSER_ATLAS_COLUMNS;
+    rows = std::min((rows + 3) & ~3, max_height / BROWSER_THUMB_H);
+    if (rows * BROWSER_ATLAS_COLUMNS <= browser.atlas_capacity)
+        return;
+
+    if (browser.atlas)
+        SDL_DestroyTexture(browser.atlas);
+    int w = BROWSER_ATLAS_COLUMNS * BROWSER_THUMB_W, h = rows * BROWSER_THUMB_H;
+    browser.atlas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, w, h);
+    if (!browser.atlas) {
+        SDL_Log("browser: cannot create a %dx%d atlas: %s", w, h, SDL_GetError());
+        browser.atlas_capacity = 0;
+        return;
+    }
+    browser.atlas_capacity = rows * BROWSER_ATLAS_COLUMNS;
+    for (int i = 0; i < (int)browser.slots.size(); i++)
+        BrowserUpload(i);
+}
+
+// Maps the new index to slots, keeping the thumbnails that did not change.
+static void BrowserRebuild(SDL_Renderer* renderer)
+{
+    std::unordered_map<Uint64, std::vector<Uint32>> done;
+    for (BrowserSlot& slot : browser.slots) {
+        if (slot.ready)
+            done[slot.hash] = std::move(slot.pixels);
+    }
+
+    std::vector<BrowserJob> jobs;
+    browser.slots.clear();
+    browser.pending = 0;
+    for (int i = 0; i < (int)browser.entries.size(); i++) {
+        const ThemeEntry& entry = browser.entries[i];
+        if (!entry.error.empty())
+            continue;
+        BrowserSlot slot;
+        slot.entry = i;
+        slot.hash = BrowserHash(entry);
+        auto it = done.find(slot.hash);
+        if (it != done.end() && !it->second.empty()) {
+            slot.pixels = it->second;
+            slot.ready = true;
+        } else {
+            BrowserJob job;
+            job.slot = (int)browser.slots.size();
+            job.hash = slot.hash;
+            memcpy(job.colors, entry.colors, sizeof(job.colors));
+            job.bg = entry.bg;
+            jobs.push_back(job);
+            browser.pending++;
+        }
+        browser.slots.push_back(std::move(slot));
+    }
+    std::reverse(jobs.begin(), jobs.end());     // the first themes come first
+
+    // slots moved, so the atlas is filled again; a new atlas already was
+    int capacity = browser.atlas_capacity;
+    BrowserReserveAtlas(renderer, (int)browser.slots.size());
+    if (browser.atlas_capacity == capacity) {
+        for (int i = 0; i < (int)browser.slots.size(); i++)
+            BrowserUpload(i);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(browser.mutex);
+        browser.generation++;
+        for (BrowserJob& job : jobs)
+            job.generation = browser.generation;
+        browser.jobs.swap(jobs);
+        browser.results.clear();
+    }
+    browser.wake.notify_one();
+    if (!browser.worker.joinable())
+        browser.worker = std::thread(BrowserWorkerLoop);
+}
+
+static void BrowserUpdate(SDL_Renderer* renderer)
+{
+    if (LibraryFetch(browser.entries, browser.library_version, &browser.library_stats))
+        BrowserRebuild(renderer);
+
+    std::vector<BrowserResult> results;
+    unsigned int generation;
+    {
+        std::lock_guard<std::mutex> lock(browser.mutex);
+        results.swap(browser.results);
+        generation = browser.generation;
+    }
+    for (BrowserResult& result : results) {
+        if (result.generation != generation)
+            continue;
+        BrowserSlot& slot = browser.slots[result.slot];
+        slot.pixels = std::move(result.pixels);
+        slot.ready = true;
+        browser.pending--;
+        (result.from_disk ? browser.from_disk : browser.rendered)++;
+        BrowserUpload(result.slot);
+    }
+}
+
+// Thumbnails are on their way; keeps an idle loop polling until they are shown.
+bool BrowserBusy()
+{
+    return browser_window && (browser.pending > 0 || LibraryScanning());
+}
+
+static void BrowserApply(const ThemeEntry& entry)
+{
+    memcpy(theme, entry.colors, sizeof(theme));
+    bg = entry.bg;
+    themeFile = std::filesystem::path(entry.path).filename().string();
+    SaveSettings();
+}
+
+// Draws the browser window. Returns false once it has been closed.
+int BrowserWindow(struct nk_context* ctx, SDL_Renderer* renderer)
+{
+    BrowserUpdate(renderer);
+
+    if (nk_begin(ctx, "Themes", nk_rect(borders[0] + 440, borders[1] + 20, 600, 440),
+        NK_WINDOW_BORDER | NK_WINDOW_MOVABLE | NK_WINDOW_SCALABLE | NK_WINDOW_CLOSABLE | NK_WINDOW_TITLE))
+    {
+        const LibraryStats& stats = browser.library_stats;
+        nk_layout_row_dynamic(ctx, 16, 1);
+        if (LibraryScanning() && !browser.library_version)
+            nk_label(ctx, "Scanning themes/ ...", NK_TEXT_LEFT);
+        else
+            nk_labelf(ctx, NK_TEXT_LEFT, "%d themes, %d invalid, %d thumbnails pending (%d rendered, %d from disk)",
+                stats.files, stats.invalid, browser.pending, browser.rendered, browser.from_disk);
+        float ratios[] = { 0.75f, 0.25f };
+        nk_layout_row(ctx, NK_DYNAMIC, 20, 2, ratios);
+        nk_labelf(ctx, NK_TEXT_LEFT, "Current: %s", themeFile.empty() ? "default" : themeFile.c_str());
+        if (nk_button_label(ctx, LibraryScanning() ? "Scanning..." : "Rescan"))
+            LibraryStart();
+
+        float spacing = ctx->style.window.spacing.x;
+        int columns = std::max(1, (int)((nk_window_get_content_region(ctx).w + spacing) / (BROWSER_THUMB_W + spacing)));
+        float atlas_w = BROWSER_ATLAS_COLUMNS * BROWSER_THUMB_W;
+        float atlas_h = (float)(browser.atlas_capacity / BROWSER_ATLAS_COLUMNS * BROWSER_THUMB_H);
+        nk_layout_row_static(ctx, BROWSER_THUMB_H, BROWSER_THUMB_W, columns);
+        for (int i = 0; i < (int)browser.slots.size(); i++) {
+            const BrowserSlot& slot = browser.slots[i];
+            const ThemeEntry& entry = browser.entries[slot.entry];
+            if (!slot.ready || i >= browser.atlas_capacity) {
+                // until the thumbnail is there
+                if (nk_button_label(ctx, entry.name.c_str()))
+                    BrowserApply(entry);
+                continue;
+            }
+            if (nk_widget_is_hovered(ctx))
+                nk_tooltip(ctx, entry.name.c_str());
+            if (nk_widget_is_mouse_clicked(ctx, NK_BUTTON_LEFT))
+                BrowserApply(entry);
+            struct nk_rect region = nk_rect((float)(i % BROWSER_ATLAS_COLUMNS * BROWSER_THUMB_W), (float)(i / BROWSER_ATLAS_COLUMNS * BROWSER_THUMB_H),
+                BROWSER_THUMB_W, BROWSER_THUMB_H);
+            nk_image(ctx, nk_subimage_ptr(browser.atlas, (nk_ushort)atlas_w, (nk_ushort)atlas_h, region));
+        }
+
+        if (stats.invalid && nk_tree_push(ctx, NK_TREE_TAB, "Invalid themes", NK_MINIMIZED)) {
+            nk_layout_row_dynamic(ctx, 16, 1);
+            for (const ThemeEntry& entry : browser.entries) {
+                if (entry.error.empty())
+                    continue;
+                if (nk_widget_is_hovered(ctx))
+                    nk_tooltip(ctx, entry.error.c_str());
+                nk_label(ctx, entry.name.c_str(), NK_TEXT_LEFT);
+            }
+            nk_tree_pop(ctx);
+        }
+    }
+    nk_end(ctx);
+    return !nk_window_is_closed(ctx, "Themes");
+}
+
+// Joins the worker and frees the atlas; has to run before the renderer is destroyed.
+void BrowserShutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(browser.mutex);
+        browser.quit = true;
+    }
+    browser.wake.notify_one();
+    if (browser.worker.joinable())
+        browser.worker.join();
+    if (browser.atlas)
+        SDL_DestroyTexture(browser.atlas);
+    browser.atlas = NULL;
+}
@@ -0,0 +1,33 @@
+// Theme conversion.
+//
+//   --convert IN OUT       converts the theme IN to OUT and exits
+//
+// IN may be INI or binary, it is recognized by its content; OUT is written as
+// binary if its name ends in .nkt and as INI otherwise. Runs before SDL is
+// initialized, so it works without a display, e.g. to convert a themes/
+// directory in a build script.
+
+// Returns -1 if --convert is not given, else the exit code of the conversion.
+int ParseConvertArgs(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--convert") != 0)
+            continue;
+        if (i + 2 >= argc) {
+            SDL_Log("convert: expected --convert IN OUT");
+            return 1;
+        }
+        const char* in = argv[i + 1];
+        const char* out = argv[i + 2];
+        struct nk_color colors[NK_COLOR_COUNT];
+        struct nk_colorf background;
+        std::string error;
+        if (!ParseThemeFile(in, colors, background, error) || !WriteThemeFile(out, colors, background, error)) {
+            SDL_Log("convert: %s", error.c_str());
+            return 1;
+        }
+        SDL_Log("convert: %s -> %s", in, out);
+        return 0;
+    }
+    return -1;
+}
@@ -0,0 +1,113 @@
+// Display scale changes.
+//
+// Fonts are baked at the renderer's pixel density. DpiUpdate() checks it every
+// frame: when the window has moved to a display with another scale, the
+// renderer scale follows at once and the fonts are re-baked at the new size
+// on a background thread (see nk_sdl_font_rebake), or loaded from the font
+// cache, whose key includes the pixel size. Text is drawn with the old atlas
+// until the new one is swapped in at the start of a later frame.
+
+struct DpiState {
+    float scale = 1;            // of the fonts in use
+    float rebake_scale = 0;     // being re-baked, read by the bake thread; 0 if none
+};
+
+static DpiState dpi;
+
+// Adds the fonts at a scale. Runs on the re-bake thread too, so it may only
+// touch the atlas.
+static void DpiAddFonts(struct nk_font_atlas* atlas, void* userdata)
+{
+    float scale = *(const float*)userdata;
+    struct nk_font_config config = nk_font_config(0);
+    /* only ASCII is baked up front, other glyphs are rasterized on first use */
+    static const nk_rune ascii_range[] = { 0x0020, 0x007E, 0 };
+    config.range = ascii_range;
+
+    /* font sizes are multiplied by the scale to produce better results at higher DPIs */
+    nk_font_atlas_add_default(atlas, 13 * scale, &config);
+    /*nk_font_atlas_add_from_file(atlas, "../../../extra_font/DroidSans.ttf", 14 * scale, &config);*/
+    /*nk_font_atlas_add_from_file(atlas, "../../../extra_font/Roboto-Regular.ttf", 16 * scale, &config);*/
+    /*nk_font_atlas_add_from_file(atlas, "../../../extra_font/kenvector_future_thin.ttf", 13 * scale, &config);*/
+    /*nk_font_atlas_add_from_file(atlas, "../../../extra_font/ProggyClean.ttf", 12 * scale, &config);*/
+    /*nk_font_atlas_add_from_file(atlas, "../../../extra_font/ProggyTiny.ttf", 10 * scale, &config);*/
+    /*nk_font_atlas_add_from_file(atlas, "../../../extra_font/Cousine-Regular.ttf", 13 * scale, &config);*/
+}
+
+static void DpiUseFonts(struct nk_context* ctx, struct nk_font_atlas* atlas, float scale)
+{
+    struct nk_sdl_font_cache_stats font_stats;
+    nk_sdl_font_cache_stats(&font_stats);
+    SDL_Log("font atlas at scale %.2f: %s in %.2f ms", scale, font_stats.hit ? "loaded from cache" : "baked", font_stats.ms);
+
+    dpi.scale = scale;
+    nk_sdl_set_dpi_scale(scale);
+    struct nk_font* font = atlas->fonts; // the first one DpiAddFonts() added
+    if (!font)
+        return;
+    /* this hack makes the font appear to be scaled down to the desired
+     * size and is only necessary when scale > 1 */
+    font->handle.height /= scale;
+    /*nk_style_load_all_cursors(ctx, atlas->cursors);*/
+    nk_style_set_font(ctx, &font->handle);
+}
+
+// Scales the renderer output for High-DPI displays. Returns the scale, 1
+// without a window.
+float DpiUpdateRendererScale(SDL_Window* win, SDL_Renderer* renderer)
+{
+    if (!win)
+        return 1;
+    int render_w, render_h;
+    int window_w, window_h;
+    float scale_x, scale_y, current_x, current_y;
+    SDL_GetRendererOutputSize(renderer, &render_w, &render_h);
+    SDL_GetWindowSize(win, &window_w, &window_h);
+    if (window_w <= 0 || window_h <= 0)
+        return dpi.scale;
+    scale_x = (float)(render_w) / (float)(window_w);
+    scale_y = (float)(render_h) / (float)(window_h);
+    SDL_RenderGetScale(renderer, &current_x, &current_y);
+    if (scale_x != current_x || scale_y != current_y)
+        SDL_RenderSetScale(renderer, scale_x, scale_y);
+    return scale_y;
+}
+
+// Bakes the fonts for the startup scale, blocking.
+void DpiInitFonts(struct nk_context* ctx, float scale)
+{
+    struct nk_font_atlas* atlas;
+    nk_sdl_font_stash_begin(&atlas);
+    DpiAddFonts(atlas, &scale);
+    nk_sdl_set_lazy_glyphs(1);
+    {
+        /* baking dominates a cold start, the atlas is reused from here */
+        std::error_code ec;
+        std::filesystem::create_directories("cache", ec);
+        nk_sdl_set_font_cache(ec ? NULL : "cache");
+    }
+    nk_sdl_font_stash_end();
+    DpiUseFonts(ctx, atlas, scale);
+}
+
+// Call once per frame, before the UI pass.
+void DpiUpdate(struct nk_context* ctx, SDL_Window* win, SDL_Renderer* renderer)
+{
+    if (struct nk_font_atlas* atlas = nk_sdl_font_rebake_poll()) {
+        DpiUseFonts(ctx, atlas, dpi.rebake_scale);
+        dpi.rebake_scale = 0;
+        prev_window_w = prev_window_h = 0; // recompute the layout constants in maingui
+    }
+    if (!win)
+        return;
+
+    float scale = DpiUpdateRendererScale(win, renderer);
+    if (scale == (dpi.rebake_scale ? dpi.rebake_scale : dpi.scale))
+        return;
+    if (nk_sdl_font_rebaking())
+        return; // for another scale, this one follows once it is swapped in
+    SDL_Log("display scale changed from %.2f to %.2f", dpi.scale, scale);
+    dpi.rebake_scale = scale;
+    if (!nk_sdl_font_rebake(DpiAddFonts, &dpi.rebake_scale))
+        dpi.rebake_scale = 0;
+}
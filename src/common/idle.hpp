@@ -0,0 +1,102 @@
+// Event-driven pacing for the main loop.
+//
+// When idle_mode is enabled the loop blocks in SDL_WaitEventTimeout() instead of
+// spinning on SDL_PollEvent(), as long as the previous frame had no input and
+// produced no visible change. Input keeps the loop "hot" for a short while so
+// drags on the color picker and sliders are not throttled.
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#define IDLE_HOT_PERIOD_MS 250
+#define IDLE_WAIT_TIMEOUT_MS 1000
+#define IDLE_CPU_TARGET_PERCENT 1.0
+
+struct IdleStats {
+    Uint64 frames = 0;
+    Uint64 waits = 0;        // times the loop blocked
+    Uint64 wakeups = 0;      // waits that ended with an event rather than the timeout
+    double idle_seconds = 0; // wall time spent in idle stretches
+    double idle_cpu = 0;     // process CPU time used during those stretches
+};
+
+static IdleStats idle_stats;
+static Uint64 idle_hot_until = 0;
+static bool idle_last_changed = true;
+static bool idle_in_stretch = false;
+static Uint64 idle_stretch_start = 0;
+static double idle_stretch_cpu = 0;
+
+static double ProcessCpuSeconds()
+{
+#if defined(_WIN32)
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+        return 0;
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime; k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime; u.HighPart = user.dwHighDateTime;
+    return (k.QuadPart + u.QuadPart) * 1e-7;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+        (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#endif
+}
+
+static void IdleEndStretch()
+{
+    if (!idle_in_stretch)
+        return;
+    idle_in_stretch = false;
+    idle_stats.idle_seconds += (double)(SDL_GetPerformanceCounter() - idle_stretch_start) / SDL_GetPerformanceFrequency();
+    idle_stats.idle_cpu += ProcessCpuSeconds() - idle_stretch_cpu;
+}
+
+// Blocks until an event arrives if the loop is idle. Returns 1 and fills evt
+// when an event was received, 0 if the loop should just poll as usual.
+int IdleWaitEvent(SDL_Event* evt)
+{
+    if (!idle_mode || idle_last_changed || SDL_GetTicks64() < idle_hot_until)
+        return 0;
+
+    if (!idle_in_stretch) {
+        idle_in_stretch = true;
+        idle_stretch_start = SDL_GetPerformanceCounter();
+        idle_stretch_cpu = ProcessCpuSeconds();
+    }
+    idle_stats.waits++;
+    if (!SDL_WaitEventTimeout(evt, IDLE_WAIT_TIMEOUT_MS))
+        return 0;
+    idle_stats.wakeups++;
+    return 1;
+}
+
+// Records the outcome of a frame: whether it consumed input and whether its
+// output differed from the previous one.
+void IdleEndFrame(bool had_input, bool changed)
+{
+    idle_stats.frames++;
+    idle_last_changed = changed;
+    if (had_input) {
+        idle_hot_until = SDL_GetTicks64() + IDLE_HOT_PERIOD_MS;
+        IdleEndStretch();
+    }
+}
+
+void IdleReport()
+{
+    IdleEndStretch();
+    if (idle_stats.idle_seconds <= 0)
+        return;
+    double cpu_percent = 100.0 * idle_stats.idle_cpu / idle_stats.idle_seconds;
+    SDL_Log("idle: %.1fs idle over %llu frames, %llu waits (%llu woken by events), %.2f%% CPU while idle (target < %.1f%%)%s",
+        idle_stats.idle_seconds, (unsigned long long)idle_stats.frames,
+        (unsigned long long)idle_stats.waits, (unsigned long long)idle_stats.wakeups,
+        cpu_percent, IDLE_CPU_TARGET_PERCENT, cpu_percent > IDLE_CPU_TARGET_PERCENT ? " - over target" : "");
+}
@@ -0,0 +1,88 @@
+// Input event coalescing.
+//
+// Sits between SDL_PollEvent() and nk_sdl_handle_event(). During fast drags
+// on the hue bar or the color sliders dozens of motion and wheel events arrive
+// per frame, but nuklear only keeps the last mouse position and the summed
+// scroll delta. So consecutive SDL_MOUSEMOTION events collapse into the
+// latest one (relative motion summed, for grabbed mice) and consecutive
+// SDL_MOUSEWHEEL events into one with the summed deltas. Buttons, keys, text
+// and everything else pass through in order, after the merged event held
+// back before them, so a click still lands where the mouse was.
+
+struct InputStats {
+    Uint64 events = 0;          // received from SDL
+    Uint64 delivered = 0;       // passed on to nuklear
+    Uint64 motion_merged = 0;
+    Uint64 wheel_merged = 0;
+};
+
+static InputStats input_stats;
+static SDL_Event input_pending;
+static bool input_has_pending = false;
+
+// Folds evt into the held back event if both are of the same mergeable kind.
+static bool InputMerge(SDL_Event& into, const SDL_Event& evt)
+{
+    if (into.type != evt.type)
+        return false;
+    if (evt.type == SDL_MOUSEMOTION) {
+        if (evt.motion.windowID != into.motion.windowID || evt.motion.which != into.motion.which)
+            return false;
+        Sint32 xrel = into.motion.xrel + evt.motion.xrel;
+        Sint32 yrel = into.motion.yrel + evt.motion.yrel;
+        into.motion = evt.motion;
+        into.motion.xrel = xrel;
+        into.motion.yrel = yrel;
+        input_stats.motion_merged++;
+        return true;
+    }
+    if (evt.type == SDL_MOUSEWHEEL) {
+        if (evt.wheel.windowID != into.wheel.windowID || evt.wheel.which != into.wheel.which ||
+            evt.wheel.direction != into.wheel.direction)
+            return false;
+        into.wheel.x += evt.wheel.x;
+        into.wheel.y += evt.wheel.y;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+        into.wheel.preciseX += evt.wheel.preciseX;
+        into.wheel.preciseY += evt.wheel.preciseY;
+#endif
+        input_stats.wheel_merged++;
+        return true;
+    }
+    return false;
+}
+
+static void InputDeliver(SDL_Event* evt)
+{
+    input_stats.delivered++;
+    nk_sdl_handle_event(evt);
+}
+
+// Delivers the event held back. Call after the last event of a frame.
+void InputFlush()
+{
+    if (!input_has_pending)
+        return;
+    input_has_pending = false;
+    InputDeliver(&input_pending);
+}
+
+// Passes an event on to nuklear, or holds it back to merge the next ones into.
+void InputFeed(SDL_Event* evt)
+{
+    input_stats.events++;
+    LatencyStamp();
+    if (!coalesce_input) {
+        InputDeliver(evt);
+        return;
+    }
+    if (input_has_pending && InputMerge(input_pending, *evt))
+        return;
+    InputFlush();
+    if (evt->type == SDL_MOUSEMOTION || evt->type == SDL_MOUSEWHEEL) {
+        input_pending = *evt;
+        input_has_pending = true;
+    } else {
+        InputDeliver(evt);
+    }
+}
@@ -0,0 +1,164 @@
+// Input-to-photon latency.
+//
+//   --latency-report       log a latency summary per vsync mode at exit
+//
+// Every event taken from SDL is stamped with the performance counter as it is
+// fed to nuklear (see InputFeed). The oldest stamp not yet on screen is
+// carried through maingui, overview and nk_sdl_render and becomes a sample
+// once SDL_RenderPresent returns. The pipelined renderer presents a frame one
+// loop later, so there the stamp is carried one frame further. Frames skipped
+// by render-on-change show nothing new and drop their stamp. Time an event
+// waited in SDL's queue before it was polled is not included.
+//
+// Samples go into fixed histograms, one for vsync on and one for off, so the
+// two can be compared in one run; the Profiler window charts the current one.
+
+#define LATENCY_BUCKET_MS 0.5
+#define LATENCY_BUCKETS 200         // 0 - 100 ms, the last bucket takes everything above
+#define LATENCY_CHART_COLUMNS 50
+
+struct LatencyHistogram {
+    Uint32 buckets[LATENCY_BUCKETS];
+    Uint64 count;
+    double sum_ms;
+    double max_ms;
+};
+
+struct Latency {
+    bool report = false;
+    SDL_Renderer* renderer = NULL;
+    bool vsync = false;
+    Uint64 oldest = 0;              // oldest input not yet presented, 0 if none
+    Uint64 in_flight = 0;           // pipelined: oldest input of the frame presented next
+    LatencyHistogram histograms[2]; // vsync off, on
+};
+
+static Latency latency;
+
+// Parses --latency-report; other arguments are left for others.
+void ParseLatencyArgs(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--latency-report") == 0)
+            latency.report = true;
+    }
+}
+
+void LatencyInit(SDL_Renderer* renderer)
+{
+    SDL_RendererInfo info;
+    latency.renderer = renderer;
+    latency.vsync = SDL_GetRendererInfo(renderer, &info) == 0 && (info.flags & SDL_RENDERER_PRESENTVSYNC);
+}
+
+// Samples are kept apart per mode, see LatencyReport().
+void LatencySetVSync(bool vsync)
+{
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    if (latency.renderer && SDL_RenderSetVSync(latency.renderer, vsync ? 1 : 0) == 0)
+        latency.vsync = vsync;
+#endif
+}
+
+void LatencyClear()
+{
+    memset(latency.histograms, 0, sizeof(latency.histograms));
+}
+
+// Called for every input event as it is taken from SDL.
+void LatencyStamp()
+{
+    if (!latency.oldest)
+        latency.oldest = SDL_GetPerformanceCounter();
+}
+
+// The frame was not rendered, its input changed nothing on screen.
+void LatencyFrameSkipped()
+{
+    latency.oldest = 0;
+}
+
+// Call right after SDL_RenderPresent().
+void LatencyPresented(bool pipelined)
+{
+    Uint64 now = SDL_GetPerformanceCounter();
+    Uint64 stamp = latency.oldest;
+    if (pipelined) {
+        stamp = latency.in_flight;
+        latency.in_flight = latency.oldest;
+    } else {
+        latency.in_flight = 0;
+    }
+    latency.oldest = 0;
+    if (!stamp)
+        return;
+
+    double ms = (now - stamp) * 1000.0 / SDL_GetPerformanceFrequency();
+    LatencyHistogram& h = latency.histograms[latency.vsync];
+    h.buckets[std::min((int)(ms / LATENCY_BUCKET_MS), LATENCY_BUCKETS - 1)]++;
+    h.count++;
+    h.sum_ms += ms;
+    h.max_ms = std::max(h.max_ms, ms);
+}
+
+// Upper edge of the bucket holding percentile p (0-100).
+static double LatencyPercentile(const LatencyHistogram& h, double p)
+{
+    Uint64 target = (Uint64)std::ceil(p / 100.0 * h.count), seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += h.buckets[i];
+        if (seen >= target && seen)
+            return (i + 1) * LATENCY_BUCKET_MS;
+    }
+    return h.max_ms;
+}
+
+void LatencyReport()
+{
+    if (!latency.report)
+        return;
+    for (int vsync = 0; vsync < 2; vsync++) {
+        const LatencyHistogram& h = latency.histograms[vsync];
+        if (!h.count) {
+            SDL_Log("latency: vsync %s: no samples", vsync ? "on" : "off");
+            continue;
+        }
+        SDL_Log("latency: vsync %s: %llu frames, mean %.2f ms, p50 %.1f, p95 %.1f, p99 %.1f, max %.2f ms",
+            vsync ? "on" : "off", (unsigned long long)h.count, h.sum_ms / h.count,
+            LatencyPercentile(h, 50), LatencyPercentile(h, 95), LatencyPercentile(h, 99), h.max_ms);
+    }
+}
+
+// Histogram of the current vsync mode, for the profiler window.
+void LatencyChart(struct nk_context* ctx)
+{
+    const LatencyHistogram& h = latency.histograms[latency.vsync];
+    const int per_column = LATENCY_BUCKETS / LATENCY_CHART_COLUMNS;
+    Uint32 columns[LATENCY_CHART_COLUMNS] = {};
+    Uint32 top = 1;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        columns[i / per_column] += h.buckets[i];
+        top = std::max(top, columns[i / per_column]);
+    }
+
+    float ratios[] = { 0.75f, 0.25f };
+    nk_layout_row(ctx, NK_DYNAMIC, 20, 2, ratios);
+    if (h.count) {
+        nk_labelf(ctx, NK_TEXT_LEFT, "latency p50 %.1f, p95 %.1f, p99 %.1f, max %.1f ms",
+            LatencyPercentile(h, 50), LatencyPercentile(h, 95), LatencyPercentile(h, 99), h.max_ms);
+    } else {
+        nk_label(ctx, "latency: no samples yet", NK_TEXT_LEFT);
+    }
+    int vsync = latency.vsync;
+    if (nk_checkbox_label(ctx, "VSync", &vsync))
+        LatencySetVSync(vsync != 0);
+    nk_layout_row_dynamic(ctx, 60, 1);
+    if (nk_chart_begin(ctx, NK_CHART_COLUMN, LATENCY_CHART_COLUMNS, 0, (float)top)) {
+        for (int i = 0; i < LATENCY_CHART_COLUMNS; i++)
+            nk_chart_push(ctx, (float)columns[i]);
+        nk_chart_end(ctx);
+    }
+    nk_layout_row_dynamic(ctx, 16, 1);
+    nk_labelf(ctx, NK_TEXT_LEFT, "%llu samples, 0 - %.0f ms in %.0f ms columns",
+        (unsigned long long)h.count, LATENCY_BUCKETS * LATENCY_BUCKET_MS, per_column * LATENCY_BUCKET_MS);
+}
@@ -0,0 +1,250 @@
+// Theme library.
+//
+// Indexes every .ini and .nkt file in themes/ so themes can be picked without going
+// through the file dialog one by one. LibraryStart() scans on a background
+// thread: files whose size and modification time match their entry in the
+// cache file are taken from it, the others are parsed and validated with
+// ParseThemeFile() on a pool of worker threads. The finished index replaces
+// the previous one under the lock and is written back to the cache. Invalid
+// themes are indexed with their error, so they are not parsed again either.
+//
+// The index is refreshed by calling LibraryStart() again: the theme browser
+// has a Rescan button, and the hot reload watcher (see common/watch.hpp)
+// calls it when files in themes/ change. A call during a scan queues one
+// more scan, so a change made while a scan runs is not missed.
+
+#include <atomic>
+
+#define LIBRARY_CACHE_FILE "theme_index.ini"
+
+struct ThemeEntry {
+    std::string name;                   // file name without extension
+    std::string path;
+    long long mtime = 0;                // last write time in file clock ticks
+    unsigned long long size = 0;
+    std::string error;                  // empty if the theme is valid
+    struct nk_color colors[NK_COLOR_COUNT] = {};
+    struct nk_colorf bg = {};
+};
+
+struct LibraryStats {
+    int files = 0;
+    int cached = 0;
+    int parsed = 0;
+    int invalid = 0;
+    float ms = 0;
+};
+
+struct Library {
+    std::thread scanner;
+    std::atomic<bool> cancel{ false };
+
+    std::mutex mutex;                   // guards everything below
+    bool scanning = false;
+    bool rescan = false;                // asked for while scanning, run once it is done
+    std::vector<ThemeEntry> entries;    // sorted by name
+    LibraryStats stats;
+    unsigned int version = 0;           // bumped whenever entries are replaced
+};
+
+static Library library;
+
+static bool LibraryParseColors(const std::string& hex, struct nk_color colors[NK_COLOR_COUNT])
+{
+    if (hex.size() != NK_COLOR_COUNT * 8)
+        return false;
+    for (int i = 0; i < NK_COLOR_COUNT; i++) {
+        const char* first = hex.data() + i * 8;
+        unsigned int rgba;
+        std::from_chars_result result = std::from_chars(first, first + 8, rgba, 16);
+        if (result.ec != std::errc() || result.ptr != first + 8)
+            return false;
+        colors[i] = nk_rgba(rgba >> 24, (rgba >> 16) & 0xff, (rgba >> 8) & 0xff, rgba & 0xff);
+    }
+    return true;
+}
+
+// Entries of the cache file by file name; entries that do not parse are left out.
+static std::unordered_map<std::string, ThemeEntry> LibraryLoadCache()
+{
+    TRACE_SCOPE("library load cache");
+    std::unordered_map<std::string, ThemeEntry> cached;
+    portini::Document doc;
+    if (!doc.ParseFromFile(LIBRARY_CACHE_FILE))
+        return cached;
+    for (auto& section : doc) {
+        portini::Section& keys = section.second;
+        if (!keys.HasKey("mtime") || !keys.HasKey("size"))
+            continue;
+        ThemeEntry entry;
+        entry.mtime = keys.GetKey("mtime").GetValue<long long>();
+        entry.size = keys.GetKey("size").GetValue<unsigned long long>();
+        if (keys.HasKey("error")) {
+            entry.error = keys.GetKey("error").GetValue();
+        } else {
+            if (!keys.HasKey("colors") || !keys.HasKey("bg") || !LibraryParseColors(keys.GetKey("colors").GetValue(), entry.colors))
+                continue;
+            ColorTuple<float> tuple = ParseColorTuple<float>(keys.GetKey("bg").GetValue(), 4, 0.0f, 0.0f, 0);
+            if (tuple.error)
+                continue;
+            entry.bg = { tuple.values[0], tuple.values[1], tuple.values[2], tuple.values[3] };
+        }
+        cached.emplace(section.first, std::move(entry));
+    }
+    return cached;
+}
+
+static void LibrarySaveCache(const std::vector<ThemeEntry>& entries)
+{
+    TRACE_SCOPE("library save cache");
+    portini::Document doc;
+    for (const ThemeEntry& entry : entries) {
+        portini::Section& keys = doc.CreateSection(std::filesystem::path(entry.path).filename().string());
+        keys.CreateKey("mtime") = entry.mtime;
+        keys.CreateKey("size") = entry.size;
+        if (!entry.error.empty()) {
+            std::string error = entry.error;
+            std::replace(error.begin(), error.end(), '\n', ' ');
+            keys.CreateKey("error") = error;
+            continue;
+        }
+        char hex[NK_COLOR_COUNT * 8 + 1];
+        for (int i = 0; i < NK_COLOR_COUNT; i++) {
+            const struct nk_color& c = entry.colors[i];
+            snprintf(hex + i * 8, 9, "%02x%02x%02x%02x", c.r, c.g, c.b, c.a);
+        }
+        keys.CreateKey("colors") = std::string(hex);
+        std::ostringstream bg;
+        bg << std::setprecision(9) << entry.bg.r << ", " << entry.bg.g << ", " << entry.bg.b << ", " << entry.bg.a;
+        keys.CreateKey("bg") = bg.str();
+    }
+    if (!doc.SerializeToFile(LIBRARY_CACHE_FILE))
+        SDL_Log("library: cannot write %s", LIBRARY_CACHE_FILE);
+}
+
+static void LibraryScan(const std::string& dir)
+{
+    TRACE_SCOPE("library scan");
+    Uint64 start = SDL_GetPerformanceCounter();
+    std::unordered_map<std::string, ThemeEntry> cached = LibraryLoadCache();
+
+    LibraryStats stats;
+    std::vector<ThemeEntry> entries;
+    std::vector<size_t> stale;          // indices into entries that need parsing
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        const std::filesystem::directory_entry& file = *it;
+        if (!file.is_regular_file(ec) || (file.path().extension() != ".ini" && file.path().extension() != ".nkt"))
+            continue;
+        ThemeEntry entry;
+        entry.path = file.path().string();
+        entry.name = file.path().stem().string();
+        entry.size = file.file_size(ec);
+        entry.mtime = file.last_write_time(ec).time_since_epoch().count();
+
+        auto hit = cached.find(file.path().filename().string());
+        if (hit != cached.end() && hit->second.size == entry.size && hit->second.mtime == entry.mtime) {
+            entry.error = std::move(hit->second.error);
+            memcpy(entry.colors, hit->second.colors, sizeof(entry.colors));
+            entry.bg = hit->second.bg;
+            stats.cached++;
+        } else {
+            stale.push_back(entries.size());
+        }
+        entries.push_back(std::move(entry));
+    }
+
+    // every worker takes the next stale file until none are left
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        TraceThreadName("library worker");
+        for (size_t i; !library.cancel && (i = next++) < stale.size();) {
+            ThemeEntry& entry = entries[stale[i]];
+            ParseThemeFile(entry.path.c_str(), entry.colors, entry.bg, entry.error);
+        }
+    };
+    size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), stale.size());
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < threads; i++)
+        pool.emplace_back(work);
+    if (threads)
+        work();
+    for (std::thread& thread : pool)
+        thread.join();
+    if (library.cancel)
+        return;
+
+    std::sort(entries.begin(), entries.end(), [](const ThemeEntry& a, const ThemeEntry& b) { return a.name < b.name; });
+    if (!stale.empty() || cached.size() != entries.size())
+        LibrarySaveCache(entries);
+
+    stats.files = (int)entries.size();
+    stats.parsed = (int)stale.size();
+    for (const ThemeEntry& entry : entries)
+        stats.invalid += !entry.error.empty();
+    stats.ms = (float)((SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+    SDL_Log("library: %d themes in %s, %d from cache, %d parsed on %d threads, %d invalid, %.1f ms",
+        stats.files, dir.c_str(), stats.cached, stats.parsed, (int)threads, stats.invalid, stats.ms);
+
+    std::lock_guard<std::mutex> lock(library.mutex);
+    library.entries.swap(entries);
+    library.stats = stats;
+    library.version++;
+}
+
+static void LibraryScanner(std::string dir)
+{
+    TraceThreadName("library");
+    for (;;) {
+        LibraryScan(dir);
+        std::lock_guard<std::mutex> lock(library.mutex);
+        if (!library.rescan || library.cancel) {
+            library.scanning = false;
+            return;
+        }
+        library.rescan = false;
+    }
+}
+
+// Starts indexing themes/ in the background. During a scan, another one is
+// queued to run after it. Safe to call from any thread.
+void LibraryStart()
+{
+    std::lock_guard<std::mutex> lock(library.mutex);
+    if (library.scanning) {
+        library.rescan = true;
+        return;
+    }
+    if (library.scanner.joinable())
+        library.scanner.join();
+    library.scanning = true;
+    library.scanner = std::thread(LibraryScanner, (std::filesystem::current_path() / "themes").string());
+}
+
+// Copies the index into `entries` if it changed since `version`, which is
+// updated. Returns false if there is nothing new.
+bool LibraryFetch(std::vector<ThemeEntry>& entries, unsigned int& version, LibraryStats* stats = NULL)
+{
+    std::lock_guard<std::mutex> lock(library.mutex);
+    if (library.version == version)
+        return false;
+    entries = library.entries;
+    version = library.version;
+    if (stats)
+        *stats = library.stats;
+    return true;
+}
+
+bool LibraryScanning()
+{
+    std::lock_guard<std::mutex> lock(library.mutex);
+    return library.scanning;
+}
+
+// Stops a running scan; has to run before TraceShutdown().
+void LibraryShutdown()
+{
+    library.cancel = true;
+    if (library.scanner.joinable())
+        library.scanner.join();
+}
@@ -0,0 +1,90 @@
+// Memory window.
+//
+// Lists, per allocation region of the SDL backend, the bytes used by the last
+// rendered frame, what is reserved from the heap, the high-water marks of
+// both and the heap allocations per frame (see nk_sdl_memory_stats). Use the
+// peaks to size fixed buffers; a steady frame should allocate nothing. The
+// glyph line shows how the lazily baked font texture is used.
+
+static std::string MemoryFormatBytes(nk_size bytes)
+{
+    char text[32];
+    if (bytes >= 1024 * 1024)
+        snprintf(text, sizeof(text), "%.2f MB", bytes / (1024.0 * 1024.0));
+    else if (bytes >= 1024)
+        snprintf(text, sizeof(text), "%.1f KB", bytes / 1024.0);
+    else
+        snprintf(text, sizeof(text), "%u B", (unsigned int)bytes);
+    return text;
+}
+
+// Logs the high-water marks, e.g. at the end of a headless run.
+void MemoryReport()
+{
+    struct nk_sdl_memory_stats stats[NK_SDL_MEMORY_COUNT];
+    nk_sdl_memory_stats(stats);
+    for (int i = 0; i < NK_SDL_MEMORY_COUNT; i++) {
+        SDL_Log("memory: %-8s used peak %s, reserved peak %s, %lu allocations",
+            nk_sdl_memory_region_name((enum nk_sdl_memory_region)i),
+            MemoryFormatBytes(stats[i].used_peak).c_str(), MemoryFormatBytes(stats[i].reserved_peak).c_str(), stats[i].allocs);
+    }
+    struct nk_sdl_glyph_stats glyphs;
+    nk_sdl_glyph_stats(&glyphs);
+    SDL_Log("memory: glyphs   %d baked, %d lazy, %d missing, %lu hits, %lu misses, texture %dx%d",
+        glyphs.baked, glyphs.lazy, glyphs.missing, glyphs.hits, glyphs.misses, glyphs.width, glyphs.height);
+}
+
+// Draws the memory window. Returns false once it has been closed.
+int MemoryWindow(struct nk_context* ctx)
+{
+    if (nk_begin(ctx, "Memory", nk_rect(borders[0] + 440, borders[1] + borders[3] * 0.55f, 520, 300),
+        NK_WINDOW_BORDER | NK_WINDOW_MOVABLE | NK_WINDOW_SCALABLE | NK_WINDOW_CLOSABLE | NK_WINDOW_TITLE))
+    {
+        struct nk_sdl_memory_stats stats[NK_SDL_MEMORY_COUNT];
+        nk_sdl_memory_stats(stats);
+
+        float ratios[] = { 0.16f, 0.17f, 0.17f, 0.17f, 0.17f, 0.16f };
+        nk_layout_row(ctx, NK_DYNAMIC, 16, 6, ratios);
+        nk_label(ctx, "region", NK_TEXT_LEFT);
+        nk_label(ctx, "used", NK_TEXT_RIGHT);
+        nk_label(ctx, "peak", NK_TEXT_RIGHT);
+        nk_label(ctx, "reserved", NK_TEXT_RIGHT);
+        nk_label(ctx, "peak", NK_TEXT_RIGHT);
+        nk_label(ctx, "allocs", NK_TEXT_RIGHT);
+
+        nk_size used = 0, reserved = 0;
+        unsigned long frame_allocs = 0;
+        for (int i = 0; i < NK_SDL_MEMORY_COUNT; i++) {
+            const struct nk_sdl_memory_stats& s = stats[i];
+            nk_label(ctx, nk_sdl_memory_region_name((enum nk_sdl_memory_region)i), NK_TEXT_LEFT);
+            nk_label(ctx, MemoryFormatBytes(s.used).c_str(), NK_TEXT_RIGHT);
+            nk_label(ctx, MemoryFormatBytes(s.used_peak).c_str(), NK_TEXT_RIGHT);
+            nk_label(ctx, MemoryFormatBytes(s.reserved).c_str(), NK_TEXT_RIGHT);
+            nk_label(ctx, MemoryFormatBytes(s.reserved_peak).c_str(), NK_TEXT_RIGHT);
+            nk_labelf(ctx, NK_TEXT_RIGHT, "%lu / %lu", s.frame_allocs, s.allocs);
+            used += s.used;
+            reserved += s.reserved;
+            frame_allocs += s.frame_allocs;
+        }
+
+        nk_layout_row_dynamic(ctx, 20, 1);
+        nk_labelf(ctx, NK_TEXT_LEFT, "Total: %s used, %s reserved, %lu allocations last frame",
+            MemoryFormatBytes(used).c_str(), MemoryFormatBytes(reserved).c_str(), frame_allocs);
+        struct nk_sdl_arena_stats arena;
+        nk_sdl_arena_stats(&arena);
+        if (arena.size) {
+            nk_labelf(ctx, NK_TEXT_LEFT, "Arena: %s of %s, peak %s, %lu overflows", MemoryFormatBytes(arena.used).c_str(),
+                MemoryFormatBytes(arena.size).c_str(), MemoryFormatBytes(arena.peak).c_str(), arena.overflows);
+        }
+        struct nk_sdl_glyph_stats glyphs;
+        nk_sdl_glyph_stats(&glyphs);
+        if (glyphs.width) {
+            nk_labelf(ctx, NK_TEXT_LEFT, "Glyphs: %d baked, %d lazy, %d missing, %lu hits, %lu misses",
+                glyphs.baked, glyphs.lazy, glyphs.missing, glyphs.hits, glyphs.misses);
+            nk_labelf(ctx, NK_TEXT_LEFT, "Font texture: %dx%d, %d uploads, %d grows",
+                glyphs.width, glyphs.height, glyphs.uploads, glyphs.grows);
+        }
+    }
+    nk_end(ctx);
+    return !nk_window_is_closed(ctx, "Memory");
+}
@@ -0,0 +1,203 @@
+// Frame profiler.
+//
+// Each phase of the main loop is timed with a ProfileScope and accumulated
+// into the current frame; ProfileEndFrame() stores it in a fixed-size ring
+// buffer of the last PROFILE_HISTORY frames. The "Profiler" window charts the
+// frame times, lists p50/p95/p99 per phase and exports the history as CSV.
+// It also shows the input coalescing counters, see common/input.hpp, and the
+// input latency histogram, see common/latency.hpp.
+//
+// Frames dropped by render-on-change are not recorded. While the profiler is
+// off, a scope costs one branch and nothing is stored.
+
+#define PROFILE_HISTORY 512
+
+enum ProfilePhase {
+    PROFILE_INPUT,
+    PROFILE_MAINGUI,
+    PROFILE_OVERVIEW,
+    PROFILE_CONVERT,    // reported by the SDL backend, see nk_sdl_render_stats
+    PROFILE_DRAW,
+    PROFILE_PRESENT,
+    PROFILE_PHASE_COUNT
+};
+
+static const char* profile_phase_names[PROFILE_PHASE_COUNT] = {
+    "input", "maingui", "overview", "convert", "draw", "present"
+};
+
+struct ProfileFrame {
+    Uint64 start;                       // performance counter at frame start
+    float ms[PROFILE_PHASE_COUNT];
+    float total;
+};
+
+struct Profiler {
+    bool enabled = false;
+    ProfileFrame frames[PROFILE_HISTORY];
+    int head = 0;                       // next slot to write
+    int count = 0;
+    ProfileFrame current;
+    Uint64 origin = 0;                  // start of the first recorded frame
+};
+
+static Profiler profiler;
+
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfilePhase phase)
+        : phase_(phase), start_(profiler.enabled ? SDL_GetPerformanceCounter() : 0) {}
+    ~ProfileScope() {
+        if (start_)
+            profiler.current.ms[phase_] += (float)((SDL_GetPerformanceCounter() - start_) * 1000.0 / SDL_GetPerformanceFrequency());
+    }
+
+private:
+    ProfilePhase phase_;
+    Uint64 start_;
+};
+
+void ProfileSetEnabled(bool enable)
+{
+    if (enable == profiler.enabled)
+        return;
+    profiler.enabled = enable;
+    profiler.head = 0;
+    profiler.count = 0;
+    profiler.origin = 0;
+}
+
+void ProfileBeginFrame()
+{
+    if (!profiler.enabled)
+        return;
+    memset(&profiler.current, 0, sizeof(profiler.current));
+    profiler.current.start = SDL_GetPerformanceCounter();
+    if (!profiler.origin)
+        profiler.origin = profiler.current.start;
+}
+
+// Adds time measured elsewhere, e.g. by the renderer, to the current frame.
+void ProfileAdd(ProfilePhase phase, float ms)
+{
+    if (profiler.enabled)
+        profiler.current.ms[phase] += ms;
+}
+
+void ProfileEndFrame()
+{
+    if (!profiler.enabled)
+        return;
+    ProfileFrame& frame = profiler.current;
+    frame.total = 0;
+    for (int i = 0; i < PROFILE_PHASE_COUNT; i++)
+        frame.total += frame.ms[i];
+    profiler.frames[profiler.head] = frame;
+    profiler.head = (profiler.head + 1) % PROFILE_HISTORY;
+    if (profiler.count < PROFILE_HISTORY)
+        profiler.count++;
+}
+
+// i = 0 is the oldest recorded frame
+static const ProfileFrame& ProfileFrameAt(int i)
+{
+    return profiler.frames[(profiler.head - profiler.count + i + PROFILE_HISTORY) % PROFILE_HISTORY];
+}
+
+// Percentile p (0-100) of a phase over the history, PROFILE_PHASE_COUNT for the frame total.
+static float ProfilePercentile(std::vector<float>& scratch, int phase, float p)
+{
+    scratch.clear();
+    for (int i = 0; i < profiler.count; i++) {
+        const ProfileFrame& frame = ProfileFrameAt(i);
+        scratch.push_back(phase == PROFILE_PHASE_COUNT ? frame.total : frame.ms[phase]);
+    }
+    if (scratch.empty())
+        return 0;
+    size_t n = std::min(scratch.size() - 1, (size_t)(p / 100.0f * scratch.size()));
+    std::nth_element(scratch.begin(), scratch.begin() + n, scratch.end());
+    return scratch[n];
+}
+
+bool ProfileExportCSV(const char* path)
+{
+    std::ofstream out(path);
+    if (!out)
+        return false;
+    out << "frame,start_ms";
+    for (int i = 0; i < PROFILE_PHASE_COUNT; i++)
+        out << ',' << profile_phase_names[i];
+    out << ",total\n";
+    out << std::fixed << std::setprecision(4);
+    double freq = (double)SDL_GetPerformanceFrequency();
+    for (int i = 0; i < profiler.count; i++) {
+        const ProfileFrame& frame = ProfileFrameAt(i);
+        out << i << ',' << (frame.start - profiler.origin) * 1000.0 / freq;
+        for (int p = 0; p < PROFILE_PHASE_COUNT; p++)
+            out << ',' << frame.ms[p];
+        out << ',' << frame.total << '\n';
+    }
+    return (bool)out;
+}
+
+// Draws the profiler window. Returns false once it has been closed.
+int ProfilerWindow(struct nk_context* ctx)
+{
+    static std::vector<float> scratch;
+
+    if (nk_begin(ctx, "Profiler", nk_rect(borders[0], borders[1] + borders[3] * 0.55f, 420, 470),
+        NK_WINDOW_BORDER | NK_WINDOW_MOVABLE | NK_WINDOW_SCALABLE | NK_WINDOW_CLOSABLE | NK_WINDOW_TITLE))
+    {
+        float max_ms = 1.0f;
+        for (int i = 0; i < profiler.count; i++)
+            max_ms = std::max(max_ms, ProfileFrameAt(i).total);
+
+        nk_layout_row_dynamic(ctx, 20, 1);
+        nk_labelf(ctx, NK_TEXT_LEFT, "%d frames, scale 0 - %.2f ms", profiler.count, max_ms);
+        nk_layout_row_dynamic(ctx, 100, 1);
+        if (nk_chart_begin_colored(ctx, NK_CHART_LINES, nk_rgb(255, 200, 0), nk_rgb(255, 255, 255), profiler.count, 0, max_ms)) {
+            nk_chart_add_slot_colored(ctx, NK_CHART_LINES, nk_rgb(0, 160, 255), nk_rgb(255, 255, 255), profiler.count, 0, max_ms);
+            for (int i = 0; i < profiler.count; i++) {
+                const ProfileFrame& frame = ProfileFrameAt(i);
+                nk_chart_push_slot(ctx, frame.total, 0);
+                nk_chart_push_slot(ctx, frame.ms[PROFILE_CONVERT] + frame.ms[PROFILE_DRAW], 1);
+            }
+            nk_chart_end(ctx);
+        }
+        nk_layout_row_dynamic(ctx, 16, 1);
+        nk_label(ctx, "yellow: frame, blue: convert + draw", NK_TEXT_LEFT);
+        nk_labelf(ctx, NK_TEXT_LEFT, "input: %llu events, %llu merged (%llu motion, %llu wheel)",
+            (unsigned long long)input_stats.events, (unsigned long long)(input_stats.motion_merged + input_stats.wheel_merged),
+            (unsigned long long)input_stats.motion_merged, (unsigned long long)input_stats.wheel_merged);
+        LatencyChart(ctx);
+
+        float ratios[] = { 0.34f, 0.22f, 0.22f, 0.22f };
+        nk_layout_row(ctx, NK_DYNAMIC, 16, 4, ratios);
+        nk_label(ctx, "phase (ms)", NK_TEXT_LEFT);
+        nk_label(ctx, "p50", NK_TEXT_RIGHT);
+        nk_label(ctx, "p95", NK_TEXT_RIGHT);
+        nk_label(ctx, "p99", NK_TEXT_RIGHT);
+        for (int phase = 0; phase <= PROFILE_PHASE_COUNT; phase++) {
+            nk_label(ctx, phase == PROFILE_PHASE_COUNT ? "total" : profile_phase_names[phase], NK_TEXT_LEFT);
+            nk_labelf(ctx, NK_TEXT_RIGHT, "%.3f", ProfilePercentile(scratch, phase, 50));
+            nk_labelf(ctx, NK_TEXT_RIGHT, "%.3f", ProfilePercentile(scratch, phase, 95));
+            nk_labelf(ctx, NK_TEXT_RIGHT, "%.3f", ProfilePercentile(scratch, phase, 99));
+        }
+
+        nk_layout_row_dynamic(ctx, 25, 2);
+        if (nk_button_label(ctx, "Export CSV")) {
+            const char* lFilterPatterns[1] = { "*.csv" };
+            const char* path = tinyfd_saveFileDialog("Export profile as...", "profile.csv", 1, lFilterPatterns, "CSV File");
+            if (path && !ProfileExportCSV(path))
+                tinyfd_messageBox("Error", "Failed to write the profile.", "ok", "error", 1);
+        }
+        if (nk_button_label(ctx, "Clear")) {
+            profiler.head = 0;
+            profiler.count = 0;
+            input_stats = InputStats();
+            LatencyClear();
+        }
+    }
+    nk_end(ctx);
+    return !nk_window_is_closed(ctx, "Profiler");
+}
@@ -0,0 +1,205 @@
+// Chrome tracing.
+//
+//   --trace=FILE.json      record spans and write them as trace-event JSON
+//
+// Spans are recorded as begin/end events into a buffer owned by the calling
+// thread, so recording takes no lock. Full buffers are handed to a writer
+// thread that streams them to the file; the rest is flushed by
+// TraceShutdown(). Open the file in chrome://tracing or ui.perfetto.dev.
+//
+// Besides TRACE_SCOPE for app code, this header fills in the tracing hooks of
+// portini.h and the SDL backend, so it has to be included before them.
+
+#include <SDL.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#define TRACE_BUFFER_EVENTS 4096
+
+struct TraceEvent {
+    const char* name;                   // string literal, not copied
+    char phase;                         // 'B' or 'E'
+    Uint64 counter;                     // performance counter
+};
+
+struct TraceBuffer {
+    int tid;
+    const char* thread_name = NULL;
+    std::vector<TraceEvent> events;
+};
+
+struct TraceBatch {
+    int tid;
+    std::vector<TraceEvent> events;
+};
+
+struct Tracer {
+    bool enabled = false;               // only changed while no other thread traces
+    std::string path;
+    std::ofstream out;
+    Uint64 origin = 0;
+    bool first = true;                  // no event written yet, for the commas
+
+    std::mutex mutex;                   // guards everything below
+    std::condition_variable wake;
+    std::vector<TraceBatch> queue;
+    std::vector<TraceBuffer*> buffers;  // one per thread that traced, never freed before shutdown
+    std::thread writer;
+    bool quit = false;
+};
+
+static Tracer tracer;
+static thread_local TraceBuffer* trace_buffer = NULL;
+
+static TraceBuffer* TraceLocalBuffer()
+{
+    if (!trace_buffer) {
+        trace_buffer = new TraceBuffer;
+        trace_buffer->events.reserve(TRACE_BUFFER_EVENTS);
+        std::lock_guard<std::mutex> lock(tracer.mutex);
+        trace_buffer->tid = (int)tracer.buffers.size() + 1;
+        tracer.buffers.push_back(trace_buffer);
+    }
+    return trace_buffer;
+}
+
+// Writer thread only, or after it has been joined.
+static void TraceSeparator()
+{
+    tracer.out << (tracer.first ? "\n" : ",\n");
+    tracer.first = false;
+}
+
+static void TraceWriteEvents(int tid, const std::vector<TraceEvent>& events)
+{
+    double to_us = 1000000.0 / SDL_GetPerformanceFrequency();
+    for (const TraceEvent& e : events) {
+        TraceSeparator();
+        tracer.out << "{\"name\":\"" << e.name << "\",\"ph\":\"" << e.phase << "\",\"ts\":"
+            << (e.counter - tracer.origin) * to_us << ",\"pid\":1,\"tid\":" << tid << '}';
+    }
+}
+
+static void TraceWriterLoop()
+{
+    std::unique_lock<std::mutex> lock(tracer.mutex);
+    for (;;) {
+        tracer.wake.wait(lock, [] { return tracer.quit || !tracer.queue.empty(); });
+        if (tracer.queue.empty())
+            break;
+        std::vector<TraceBatch> batches;
+        batches.swap(tracer.queue);
+        lock.unlock();
+        for (const TraceBatch& batch : batches)
+            TraceWriteEvents(batch.tid, batch.events);
+        tracer.out.flush();
+        lock.lock();
+    }
+}
+
+static void TraceRecord(const char* name, char phase)
+{
+    TraceBuffer* buffer = TraceLocalBuffer();
+    buffer->events.push_back({ name, phase, SDL_GetPerformanceCounter() });
+    if (buffer->events.size() < TRACE_BUFFER_EVENTS)
+        return;
+
+    TraceBatch batch;
+    batch.tid = buffer->tid;
+    batch.events.reserve(TRACE_BUFFER_EVENTS);
+    batch.events.swap(buffer->events);
+    {
+        std::lock_guard<std::mutex> lock(tracer.mutex);
+        tracer.queue.push_back(std::move(batch));
+    }
+    tracer.wake.notify_one();
+}
+
+void TraceBegin(const char* name)
+{
+    if (tracer.enabled)
+        TraceRecord(name, 'B');
+}
+
+void TraceEnd()
+{
+    if (tracer.enabled)
+        TraceRecord("", 'E');
+}
+
+// Names the calling thread in the trace.
+void TraceThreadName(const char* name)
+{
+    if (tracer.enabled)
+        TraceLocalBuffer()->thread_name = name;
+}
+
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) { TraceBegin(name); }
+    ~TraceScope() { TraceEnd(); }
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+
+#define NK_SDL_TRACE_BEGIN(name) TraceBegin(name)
+#define NK_SDL_TRACE_END() TraceEnd()
+#define NK_SDL_TRACE_THREAD(name) TraceThreadName(name)
+#define PORTINI_TRACE_SCOPE(name) TRACE_SCOPE(name)
+
+// Parses --trace=FILE and starts the writer; other arguments are left for others.
+// Returns false if the trace file cannot be created.
+bool ParseTraceArgs(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--trace=", 8) == 0)
+            tracer.path = argv[i] + 8;
+    }
+    if (tracer.path.empty())
+        return true;
+
+    tracer.out.open(tracer.path, std::ios_base::binary);
+    if (!tracer.out) {
+        SDL_Log("trace: cannot create '%s'", tracer.path.c_str());
+        return false;
+    }
+    tracer.out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+    tracer.origin = SDL_GetPerformanceCounter();
+    tracer.writer = std::thread(TraceWriterLoop);
+    tracer.enabled = true;
+    TraceThreadName("main");
+    return true;
+}
+
+// Flushes all buffers and closes the file. Every other thread that traced
+// must have been joined, e.g. the pipeline worker by nk_sdl_shutdown().
+void TraceShutdown()
+{
+    if (!tracer.enabled)
+        return;
+    tracer.enabled = false;
+    {
+        std::lock_guard<std::mutex> lock(tracer.mutex);
+        tracer.quit = true;
+    }
+    tracer.wake.notify_one();
+    tracer.writer.join();
+
+    for (TraceBuffer* buffer : tracer.buffers) {
+        TraceWriteEvents(buffer->tid, buffer->events);
+        if (buffer->thread_name) {
+            TraceSeparator();
+            tracer.out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+                << ",\"args\":{\"name\":\"" << buffer->thread_name << "\"}}";
+        }
+        delete buffer;
+    }
+    tracer.buffers.clear();
+    trace_buffer = NULL;
+    tracer.out << "\n]}\n";
+    tracer.out.close();
+    SDL_Log("trace: written to %s", tracer.path.c_str());
+}
@@ -0,0 +1,357 @@
+// Hot reload of the active theme and config.ini.
+//
+// A watcher thread follows config.ini and themes/<themeFile>. On Linux it
+// uses inotify on both directories, so editors that save by renaming a new
+// file over the old one are seen as well; elsewhere it compares modification
+// times every WATCH_POLL_MS. A burst of writes is handled once the files have
+// been quiet for WATCH_DEBOUNCE_MS. The files are then parsed on the watcher
+// thread, and a user event wakes the main loop to apply the result.
+//
+// Only colors that changed in the file since it was last read are applied,
+// so edits made in the editor to other colors are kept. A file that fails to
+// parse leaves the theme as it is and the error is shown in a window until
+// the next good reload.
+//
+// Themes added to, changed in or removed from themes/ also rescan the theme
+// library (see common/library.hpp), so the browser follows the directory.
+
+#include <atomic>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#define WATCH_DEBOUNCE_MS 150
+#define WATCH_POLL_MS 250
+
+struct WatchResult {
+    bool config = false;                // config.ini was parsed into config_doc
+    portini::Document config_doc;
+    bool theme = false;                 // colors, changed and bg_changed are valid
+    bool switched = false;              // config.ini names another theme, apply all of it
+    std::string theme_file;
+    struct nk_color colors[NK_COLOR_COUNT];
+    bool changed[NK_COLOR_COUNT];
+    struct nk_colorf bg;
+    bool bg_changed = false;
+    std::string error;
+};
+
+struct Watch {
+    std::thread thread;
+    std::atomic<bool> quit{ false };
+    std::atomic<bool> ready{ false };   // result holds something to apply
+    Uint32 event = (Uint32)-1;          // user event that wakes the main loop
+
+    std::mutex mutex;                   // guards theme_file and result
+    std::string theme_file;             // followed theme, set by the main thread
+    WatchResult result;
+
+    // watcher thread only: the theme file as last read
+    std::string base_file;
+    bool base_valid = false;
+    struct nk_color base_colors[NK_COLOR_COUNT];
+    struct nk_colorf base_bg;
+
+    // main thread only
+    std::string tracked;                // theme_file as last handed to the watcher
+    std::string error;                  // shown until dismissed or the next good reload
+};
+
+static Watch watch;
+
+static std::string WatchThemePath(const std::string& file)
+{
+    return (std::filesystem::path("themes") / file).string();
+}
+
+// Reads the followed theme as the new base without applying it.
+static void WatchReadBase(const std::string& file)
+{
+    std::string error;
+    watch.base_file = file;
+    watch.base_valid = !file.empty() && ParseThemeFile(WatchThemePath(file).c_str(), watch.base_colors, watch.base_bg, error);
+}
+
+// Parses what changed and hands it to the main thread.
+static void WatchReload(bool config_dirty, bool theme_dirty)
+{
+    TRACE_SCOPE("watch reload");
+    WatchResult result;
+    std::string theme_file;
+    {
+        std::lock_guard<std::mutex> lock(watch.mutex);
+        theme_file = watch.theme_file;
+    }
+
+    if (config_dirty) {
+        if (result.config_doc.ParseFromFile("config.ini")) {
+            result.config = true;
+            if (result.config_doc.HasSection("theme") && result.config_doc.GetSection("theme").HasKey("file")) {
+                std::string file = result.config_doc.GetSection("theme").GetKey("file").GetValue();
+                if (file != theme_file && !file.empty()) {
+                    theme_file = file;
+                    result.switched = true;
+                    theme_dirty = true;
+                }
+            }
+        } else {
+            result.error = "Failed to parse config.ini";
+        }
+    }
+
+    if (theme_dirty && !theme_file.empty()) {
+        struct nk_color colors[NK_COLOR_COUNT];
+        struct nk_colorf bg;
+        std::string error;
+        if (ParseThemeFile(WatchThemePath(theme_file).c_str(), colors, bg, error)) {
+            bool diff = result.switched || !watch.base_valid || watch.base_file != theme_file;
+            result.theme = true;
+            result.theme_file = theme_file;
+            memcpy(result.colors, colors, sizeof(colors));
+            result.bg = bg;
+            for (int i = 0; i < NK_COLOR_COUNT; i++) {
+                const struct nk_color& base = watch.base_colors[i];
+                result.changed[i] = diff || base.r != colors[i].r || base.g != colors[i].g || base.b != colors[i].b || base.a != colors[i].a;
+            }
+            result.bg_changed = diff || memcmp(&watch.base_bg, &bg, sizeof(bg)) != 0;
+            watch.base_file = theme_file;
+            watch.base_valid = true;
+            memcpy(watch.base_colors, colors, sizeof(colors));
+            watch.base_bg = bg;
+        } else {
+            result.error = error;
+        }
+    }
+
+    if (!result.config && !result.theme && result.error.empty())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(watch.mutex);
+        watch.result = std::move(result);
+    }
+    watch.ready = true;
+    SDL_Event evt;
+    SDL_zero(evt);
+    evt.type = watch.event;
+    SDL_PushEvent(&evt);
+}
+
+static long long WatchModified(const std::string& path)
+{
+    std::error_code ec;
+    std::filesystem::file_time_type time = std::filesystem::last_write_time(path, ec);
+    return ec ? 0 : (long long)time.time_since_epoch().count();
+}
+
+// Files the theme library indexes.
+static bool WatchIsTheme(const std::filesystem::path& path)
+{
+    return path.extension() == ".ini" || path.extension() == ".nkt";
+}
+
+// Changes whenever a theme in `dir` is added, removed or written; for polling.
+static Uint64 WatchDirSignature(const char* dir)
+{
+    Uint64 hash = 14695981039346656037ull;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (!WatchIsTheme(it->path()))
+            continue;
+        Uint64 values[3] = {
+            (Uint64)std::hash<std::string>()(it->path().filename().string()),
+            (Uint64)it->last_write_time(ec).time_since_epoch().count(),
+            (Uint64)it->file_size(ec)
+        };
+        // order independent, the directory is not listed in a fixed order
+        Uint64 entry = 14695981039346656037ull;
+        for (Uint64 value : values)
+            entry = (entry ^ value) * 1099511628211ull;
+        hash += entry;
+    }
+    return hash;
+}
+
+static void WatchLoop()
+{
+    TraceThreadName("watch");
+    std::string theme_file;
+    {
+        std::lock_guard<std::mutex> lock(watch.mutex);
+        theme_file = watch.theme_file;
+    }
+    WatchReadBase(theme_file);
+
+#if defined(__linux__)
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    int wd_config = fd >= 0 ? inotify_add_watch(fd, ".", IN_CLOSE_WRITE | IN_MOVED_TO) : -1;
+    int wd_themes = fd >= 0 ? inotify_add_watch(fd, "themes", IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE) : -1;
+    if (wd_config < 0 || wd_themes < 0)
+        SDL_Log("watch: inotify unavailable, polling modification times");
+#endif
+    long long config_time = WatchModified("config.ini");
+    long long theme_time = WatchModified(WatchThemePath(theme_file));
+    Uint64 themes_signature = WatchDirSignature("themes");
+    bool config_dirty = false, theme_dirty = false, library_dirty = false;
+    Uint64 due = 0;
+
+    while (!watch.quit) {
+        {
+            std::lock_guard<std::mutex> lock(watch.mutex);
+            if (watch.theme_file != theme_file) {
+                theme_file = watch.theme_file;
+                theme_time = WatchModified(WatchThemePath(theme_file));
+            }
+        }
+        if (theme_file != watch.base_file)
+            WatchReadBase(theme_file);
+
+        bool seen = false;
+#if defined(__linux__)
+        if (wd_config >= 0 && wd_themes >= 0) {
+            struct pollfd pfd = { fd, POLLIN, 0 };
+            if (poll(&pfd, 1, config_dirty || theme_dirty || library_dirty ? WATCH_DEBOUNCE_MS : WATCH_POLL_MS) > 0) {
+                alignas(struct inotify_event) char buffer[4096];
+                ssize_t length;
+                while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+                    for (char* p = buffer; p < buffer + length;) {
+                        const struct inotify_event* e = (const struct inotify_event*)p;
+                        p += sizeof(struct inotify_event) + e->len;
+                        if (!e->len)
+                            continue;
+                        if (e->wd == wd_config && strcmp(e->name, "config.ini") == 0)
+                            config_dirty = seen = true;
+                        else if (e->wd == wd_themes) {
+                            if (WatchIsTheme(e->name))
+                                library_dirty = seen = true;
+                            if (theme_file == e->name && (e->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)))
+                                theme_dirty = seen = true;
+                        }
+                    }
+                }
+            }
+        } else
+#endif
+        {
+            SDL_Delay(config_dirty || theme_dirty || library_dirty ? WATCH_DEBOUNCE_MS : WATCH_POLL_MS);
+            long long time = WatchModified("config.ini");
+            if (time != config_time) {
+                config_time = time;
+                config_dirty = seen = true;
+            }
+            time = WatchModified(WatchThemePath(theme_file));
+            if (time != theme_time) {
+                theme_time = time;
+                theme_dirty = seen = true;
+            }
+            Uint64 signature = WatchDirSignature("themes");
+            if (signature != themes_signature) {
+                themes_signature = signature;
+                library_dirty = seen = true;
+            }
+        }
+
+        // every write pushes the reload back
+        if (seen)
+            due = SDL_GetTicks64() + WATCH_DEBOUNCE_MS;
+        if ((config_dirty || theme_dirty || library_dirty) && SDL_GetTicks64() >= due) {
+            if (config_dirty || theme_dirty)
+                WatchReload(config_dirty, theme_dirty);
+            if (library_dirty)
+                LibraryStart();
+            config_dirty = theme_dirty = library_dirty = false;
+        }
+    }
+
+#if defined(__linux__)
+    if (fd >= 0)
+        close(fd);
+#endif
+}
+
+static void WatchStop()
+{
+    watch.quit = true;
+    if (watch.thread.joinable())
+        watch.thread.join();
+}
+
+// Call once per frame on the main thread; starts and stops the watcher with
+// hot_reload and applies what it has read.
+void WatchUpdate()
+{
+    if (!theme_initialized)
+        return;                         // settings are not loaded yet
+    if (!hot_reload) {
+        WatchStop();
+        return;
+    }
+    if (watch.tracked != themeFile || !watch.thread.joinable()) {
+        std::lock_guard<std::mutex> lock(watch.mutex);
+        watch.theme_file = themeFile;
+        watch.tracked = themeFile;
+    }
+    if (!watch.thread.joinable()) {
+        if (watch.event == (Uint32)-1)
+            watch.event = SDL_RegisterEvents(1);
+        watch.quit = false;
+        watch.thread = std::thread(WatchLoop);
+    }
+
+    if (!watch.ready.exchange(false))
+        return;
+    WatchResult result;
+    {
+        std::lock_guard<std::mutex> lock(watch.mutex);
+        result = std::move(watch.result);
+    }
+    if (result.config) {
+        LoadRenderSettings(result.config_doc);
+        SDL_Log("watch: config.ini reloaded");
+    }
+    if (result.theme) {
+        int count = 0;
+        for (int i = 0; i < NK_COLOR_COUNT; i++) {
+            if (result.changed[i]) {
+                theme[i] = result.colors[i];
+                count++;
+            }
+        }
+        if (result.bg_changed)
+            bg = result.bg;
+        if (result.switched)
+            themeFile = result.theme_file;  // handed to the watcher next frame
+        SDL_Log("watch: %s reloaded, %d colors%s changed", result.theme_file.c_str(), count, result.bg_changed ? " and background" : "");
+    }
+    watch.error = result.error;
+    if (!watch.error.empty())
+        SDL_Log("watch: reload failed, keeping the current theme: %s", watch.error.c_str());
+}
+
+// Shows the last reload error, if any.
+void WatchErrorWindow(struct nk_context* ctx)
+{
+    if (watch.error.empty())
+        return;
+    if (nk_begin(ctx, "Reload failed", nk_rect(borders[0] + 40, borders[1] + 40, 420, 150),
+        NK_WINDOW_BORDER | NK_WINDOW_MOVABLE | NK_WINDOW_TITLE))
+    {
+        nk_layout_row_dynamic(ctx, 60, 1);
+        nk_label_wrap(ctx, watch.error.c_str());
+        nk_layout_row_dynamic(ctx, 16, 1);
+        nk_label(ctx, "The last good theme stays active.", NK_TEXT_LEFT);
+        nk_layout_row_dynamic(ctx, 25, 2);
+        nk_spacing(ctx, 1);
+        if (nk_button_label(ctx, "Dismiss"))
+            watch.error.clear();
+    }
+    nk_end(ctx);
+}
+
+// Joins the watcher; has to run before TraceShutdown().
+void WatchShutdown()
+{
+    WatchStop();
+}
@@ -32,6 +32,9 @@
 #define DEFAULT_BG_COLOR_BLUE 0.24
 #define DEFAULT_COLOR_ALPHA 1.0
 
+// Delay for frames that were skipped by render-on-change, as no vsync'd present throttles them
+#define IDLE_FRAME_DELAY_MS 16
+
 constexpr double margin_left = 0.015;
 constexpr double margin_top = 0.015;
 constexpr double margin_right = 0.015;
@@ -77,13 +80,101 @@ int AppSettings(struct nk_context* ctx, nk_colorf& bg);
 int ThemeColorPicker(struct nk_context* ctx, int color_idx);
 std::string themeFile; // path to currently used theme file
 int settings_popup = nk_false;
+int render_on_change = nk_false; // skip convert/draw/present when the UI did not change
+int idle_mode = nk_false; // block on events while nothing is happening, see common/idle.hpp
+int coalesce_input = nk_true; // merge consecutive mouse motion and wheel events, see common/input.hpp
+int hot_reload = nk_true; // reload config.ini and the theme file when they change on disk, see common/watch.hpp
+int partial_redraw = nk_false; // redraw only damaged rects of a persistent render target
+int damage_overlay = nk_false; // tint the rects redrawn by partial_redraw
+int window_cache = nk_false; // draw inactive, unchanged windows from offscreen textures
+int pipelined = nk_false; // run nk_convert on a worker thread, one frame behind the UI
+int native_commands = nk_false; // draw simple primitives as plain quads instead of through nk_convert
+nk_sdl_quality quality = NK_SDL_QUALITY_FIXED; // tessellation profile, see nuklear_sdl_renderer.h
+int frame_budget_ms = 0; // fall back to the fast profile while frames take longer, 0 disables
+int profiler_window = nk_false; // per-phase frame timings, see common/profiler.hpp
+int memory_window = nk_false; // backend memory use and high-water marks, see common/memory.hpp
+int browser_window = nk_false; // thumbnails of the theme library, see common/browser.hpp
+
+void SaveRenderSettings(portini::Document& document) {
+    auto& renderSection = document.CreateSection("render");
+    renderSection.CreateKey("render_on_change") = render_on_change;
+    renderSection.CreateKey("idle_mode") = idle_mode;
+    renderSection.CreateKey("coalesce_input") = coalesce_input;
+    renderSection.CreateKey("hot_reload") = hot_reload;
+    renderSection.CreateKey("partial_redraw") = partial_redraw;
+    renderSection.CreateKey("damage_overlay") = damage_overlay;
+    renderSection.CreateKey("window_cache") = window_cache;
+    renderSection.CreateKey("pipelined") = pipelined;
+    renderSection.CreateKey("native_commands") = native_commands;
+    renderSection.CreateKey("quality") = std::string(nk_sdl_quality_name(quality));
+    renderSection.CreateKey("frame_budget_ms") = frame_budget_ms;
+}
+
+void LoadRenderSettings(portini::Document& doc) {
+    if (!doc.HasSection("render")) // not required
+        return;
+    portini::Section& renderSection = doc.GetSection("render");
+    if (renderSection.HasKey("render_on_change"))
+        render_on_change = renderSection.GetKey("render_on_change").GetValue<int>();
+    if (renderSection.HasKey("idle_mode"))
+        idle_mode = renderSection.GetKey("idle_mode").GetValue<int>();
+    if (renderSection.HasKey("coalesce_input"))
+        coalesce_input = renderSection.GetKey("coalesce_input").GetValue<int>();
+    if (renderSection.HasKey("hot_reload"))
+        hot_reload = renderSection.GetKey("hot_reload").GetValue<int>();
+    if (renderSection.HasKey("partial_redraw"))
+        partial_redraw = renderSection.GetKey("partial_redraw").GetValue<int>();
+    if (renderSection.HasKey("damage_overlay"))
+        damage_overlay = renderSection.GetKey("damage_overlay").GetValue<int>();
+    if (renderSection.HasKey("window_cache"))
+        window_cache = renderSection.GetKey("window_cache").GetValue<int>();
+    if (renderSection.HasKey("pipelined"))
+        pipelined = renderSection.GetKey("pipelined").GetValue<int>();
+    if (renderSection.HasKey("native_commands"))
+        native_commands = renderSection.GetKey("native_commands").GetValue<int>();
+    if (renderSection.HasKey("quality")) {
+        const std::string& name = renderSection.GetKey("quality").GetValue();
+        for (int i = 0; i < NK_SDL_QUALITY_COUNT; i++) {
+            if (name == nk_sdl_quality_name((nk_sdl_quality)i))
+                quality = (nk_sdl_quality)i;
+        }
+    }
+    if (renderSection.HasKey("frame_budget_ms"))
+        frame_budget_ms = renderSection.GetKey("frame_budget_ms").GetValue<int>();
+
+    nk_sdl_set_partial_redraw(partial_redraw);
+    nk_sdl_set_damage_overlay(damage_overlay);
+    nk_sdl_set_window_cache(window_cache);
+    if (unattended)
+        pipelined = nk_false; // dumped frames have to show the frame just built
+    nk_sdl_set_pipelined(pipelined);
+    nk_sdl_set_native_commands(native_commands);
+    nk_sdl_set_quality(quality);
+    nk_sdl_set_frame_budget((float)frame_budget_ms);
+}
+
+// Fingerprint of the theme colors, part of the window cache key
+unsigned int ThemeVersion() {
+    unsigned int hash = 2166136261u;
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(theme);
+    for (size_t i = 0; i < sizeof(theme); i++)
+        hash = (hash ^ bytes[i]) * 16777619u;
+    bytes = reinterpret_cast<const unsigned char*>(&bg);
+    for (size_t i = 0; i < sizeof(bg); i++)
+        hash = (hash ^ bytes[i]) * 16777619u;
+    return hash;
+}
 
 void SaveSettings() {
+    TRACE_SCOPE("SaveSettings");
+    if (unattended)
+        return; // leave the user's config.ini alone
     portini::Document document;
 
     auto& themeSection = document.CreateSection("theme");
     themeSection.CreateKey("file");
     themeSection["file"] = themeFile;
+    SaveRenderSettings(document);
 
     if (!document.SerializeToFile("config.ini")) {
         std::ostringstream oss;
@@ -94,8 +185,11 @@ void SaveSettings() {
 }
 
 int LoadSettings() {
+    TRACE_SCOPE("LoadSettings");
     portini::Document doc;
     if (doc.ParseFromFile("config.ini")) {
+        LoadRenderSettings(doc);
+
         // Access the loaded data
         if (doc.HasSection("theme")) { // not required
             portini::Section& themeSection = doc.GetSection("theme");
@@ -116,6 +210,9 @@ int LoadSettings() {
         }
         return 1;
     }
+    else if (unattended) {
+        SDL_Log("Failed to load data from config.ini - using the defaults");
+    }
     else {
         std::ostringstream oss;
         oss << "Failed to load data from config.ini - Settings will be reset." << std::endl;
@@ -132,7 +229,9 @@ void tinyfd_ColorPicker_Popup(nk_colorf & color)
 {
     unsigned char lRgbColor[3];
     char const* lTheHexColor;
+    TraceBegin("tinyfd_colorChooser");
     lTheHexColor = tinyfd_colorChooser("choose a nice color", "#FF0077", lRgbColor, lRgbColor);
+    TraceEnd();
 
     if (!lTheHexColor)
     {
@@ -268,6 +367,7 @@ int maingui(struct nk_context* ctx, SDL_Window* win, SDL_Renderer* renderer) {
     }
 
     SDL_SetRenderDrawColor(renderer, bg.r * 255, bg.g * 255, bg.b * 255, DEFAULT_COLOR_ALPHA);
+    nk_sdl_set_theme_version(ThemeVersion());
 
     int winflags;
     if(settings_popup)
@@ -278,7 +378,10 @@ int maingui(struct nk_context* ctx, SDL_Window* win, SDL_Renderer* renderer) {
     float ratio_three[] = { 0.25f, 0.50f, 0.25f };
 
     int window_w, window_h;
-    SDL_GetWindowSize(win, &window_w, &window_h);
+    if (win)
+        SDL_GetWindowSize(win, &window_w, &window_h);
+    else // headless, see common/headless.hpp
+        SDL_GetRendererOutputSize(renderer, &window_w, &window_h);
 
     if (window_w != prev_window_w || window_h != prev_window_h) {
         // Window size has changed
@@ -307,6 +410,53 @@ int maingui(struct nk_context* ctx, SDL_Window* win, SDL_Renderer* renderer) {
         nk_layout_row_dynamic(ctx, 40, 3);
         if (nk_button_label(ctx, "Settings"))
             settings_popup = nk_true;
+
+        // counters of the previous rendered frame
+        struct nk_sdl_render_stats render_stats;
+        nk_sdl_render_stats(&render_stats);
+        nk_layout_row_dynamic(ctx, 20, 1);
+        if (nk_checkbox_label(ctx, "Native draw path", &native_commands))
+            nk_sdl_set_native_commands(native_commands);
+        if (nk_checkbox_label(ctx, "Profiler", &profiler_window) && profiler_window)
+            nk_window_show(ctx, "Profiler", NK_SHOWN);
+        if (nk_checkbox_label(ctx, "Memory", &memory_window) && memory_window)
+            nk_window_show(ctx, "Memory", NK_SHOWN);
+        if (nk_checkbox_label(ctx, "Theme browser", &browser_window) && browser_window)
+            nk_window_show(ctx, "Themes", NK_SHOWN);
+        nk_labelf(ctx, NK_TEXT_LEFT, "Draw: %u commands, %u batches, %u vertices", render_stats.commands, render_stats.batches, render_stats.vertices);
+        nk_labelf(ctx, NK_TEXT_LEFT, "State: %u clip changes, %u avoided", render_stats.clip_changes, render_stats.state_changes_avoided);
+        {
+            // vertices of the last frame converted with each profile, to compare them
+            struct nk_sdl_quality_stats quality_stats;
+            nk_sdl_quality_stats(&quality_stats);
+            // formatted on the stack, this runs every frame
+            char counts[128] = "";
+            int len = 0;
+            for (int i = 0; i < NK_SDL_QUALITY_COUNT && len < (int)sizeof(counts); i++) {
+                if (!quality_stats.vertices[i] || i == quality_stats.active) continue;
+                len += snprintf(counts + len, sizeof(counts) - len, "%s%s %u", len ? ", " : " (",
+                    nk_sdl_quality_name((nk_sdl_quality)i), quality_stats.vertices[i]);
+            }
+            nk_labelf(ctx, NK_TEXT_LEFT, "Quality: %s%s, %u vertices%s%s", nk_sdl_quality_name(quality_stats.active),
+                quality_stats.active != quality_stats.profile ? " (over budget)" : "",
+                quality_stats.vertices[quality_stats.active], counts, len ? ")" : "");
+        }
+        if (partial_redraw) {
+            struct nk_sdl_damage_stats damage_stats;
+            nk_sdl_damage_stats(&damage_stats);
+            nk_labelf(ctx, NK_TEXT_LEFT, "Damage: %u rects, %.0f%% redrawn", damage_stats.rects, damage_stats.coverage * 100.0f);
+        }
+        if (window_cache) {
+            struct nk_sdl_window_cache_stats cache_stats;
+            nk_sdl_window_cache_stats(&cache_stats);
+            nk_labelf(ctx, NK_TEXT_LEFT, "Cache: %u windows, %u reused, %u filled", cache_stats.cached, cache_stats.hits, cache_stats.fills);
+        }
+        if (pipelined) {
+            struct nk_sdl_pipeline_stats pipe_stats;
+            nk_sdl_pipeline_stats(&pipe_stats, NULL);
+            nk_labelf(ctx, NK_TEXT_LEFT, "Pipeline: build %.2f, convert %.2f, wait %.2f ms", pipe_stats.build_ms, pipe_stats.convert_ms, pipe_stats.wait_ms);
+            nk_labelf(ctx, NK_TEXT_LEFT, "          snapshot %.2f, submit %.2f ms", pipe_stats.snapshot_ms, pipe_stats.submit_ms);
+        }
     }
     nk_end(ctx);
 
@@ -384,8 +534,10 @@ int AppSettings(struct nk_context* ctx, nk_colorf& bg)
                 std::string themeFilename = currentPath.string() + "/theme.ini";
                 const char* filepath = themeFilename.c_str();
                 char const* lTheSaveFileName;
-                const char* lFilterPatterns[1] = { "*.ini" };
-                lTheSaveFileName = tinyfd_saveFileDialog( "Save theme as...", filepath, 1, lFilterPatterns, "INI Theme File");
+                const char* lFilterPatterns[2] = { "*.ini", "*.nkt" };
+                TraceBegin("tinyfd_saveFileDialog");
+                lTheSaveFileName = tinyfd_saveFileDialog( "Save theme as...", filepath, 2, lFilterPatterns, "Theme File");
+                TraceEnd();
 
                 if (!lTheSaveFileName)
                 {
@@ -398,8 +550,10 @@ int AppSettings(struct nk_context* ctx, nk_colorf& bg)
                 std::string themeFilename = currentPath.string() + "/theme.ini";
                 const char* filepath = themeFilename.c_str();
                 char const* lTheOpenFileName;
-                const char* lFilterPatterns[1] = { "*.ini" };
-                lTheOpenFileName = tinyfd_openFileDialog( "Load theme", filepath, 1, lFilterPatterns, "INI Theme File", 0);
+                const char* lFilterPatterns[2] = { "*.ini", "*.nkt" };
+                TraceBegin("tinyfd_openFileDialog");
+                lTheOpenFileName = tinyfd_openFileDialog( "Load theme", filepath, 2, lFilterPatterns, "Theme File", 0);
+                TraceEnd();
 
                 if (!lTheOpenFileName)
                 {
@@ -19,6 +19,310 @@ NK_API int                  nk_sdl_handle_event(SDL_Event *evt);
 NK_API void                 nk_sdl_render(enum nk_anti_aliasing);
 NK_API void                 nk_sdl_shutdown(void);
 
+/* Vertex and element buffers are owned by the device and reused across
+ * frames. They start at the sizes below, grow through nk_convert as needed and
+ * are shrunk back once a frame has used less than a quarter of them for
+ * NK_SDL_BUFFER_SHRINK_FRAMES frames in a row (0 disables shrinking).
+ */
+#ifndef NK_SDL_VERTEX_BUFFER_SIZE
+#ifdef MAX_VERTEX_MEMORY
+#define NK_SDL_VERTEX_BUFFER_SIZE (MAX_VERTEX_MEMORY)
+#else
+#define NK_SDL_VERTEX_BUFFER_SIZE (512 * 1024)
+#endif
+#endif
+#ifndef NK_SDL_ELEMENT_BUFFER_SIZE
+#ifdef MAX_ELEMENT_MEMORY
+#define NK_SDL_ELEMENT_BUFFER_SIZE (MAX_ELEMENT_MEMORY)
+#else
+#define NK_SDL_ELEMENT_BUFFER_SIZE (128 * 1024)
+#endif
+#endif
+#ifndef NK_SDL_BUFFER_SHRINK_FRAMES
+#define NK_SDL_BUFFER_SHRINK_FRAMES 600
+#endif
+
+struct nk_sdl_buffer_stats {
+    nk_size size;           /* current capacity in bytes */
+    nk_size used;           /* bytes used by the last frame */
+    nk_size high_water;     /* largest amount ever used by a frame */
+    unsigned int grow_count;
+    unsigned int shrink_count;
+};
+
+NK_API void                 nk_sdl_set_buffer_shrink_frames(int frames);
+NK_API void                 nk_sdl_buffer_stats(struct nk_sdl_buffer_stats *vertices, struct nk_sdl_buffer_stats *elements);
+
+/* Render-on-change: after the UI pass, nk_sdl_frame_changed() fingerprints the
+ * command stream (in draw order) together with the clear color and output
+ * size. If it matches the last rendered frame the caller can drop the frame
+ * with nk_sdl_skip_frame() instead of converting, drawing and presenting it.
+ * Window, expose and render-reset events invalidate the fingerprint.
+ */
+struct nk_sdl_frame_stats {
+    unsigned long rendered;
+    unsigned long skipped;
+};
+
+NK_API int                  nk_sdl_frame_changed(void);
+NK_API void                 nk_sdl_skip_frame(void);
+NK_API void                 nk_sdl_invalidate(void);
+NK_API void                 nk_sdl_frame_stats(struct nk_sdl_frame_stats *stats);
+
+/* Consecutive draw commands that share a texture and clip rect are merged into
+ * one SDL_RenderGeometryRaw call, which only receives the vertex range its
+ * indices reference. The clip rect last set on the renderer is tracked so it
+ * is only touched on transitions. Counters below describe the last rendered
+ * frame.
+ */
+struct nk_sdl_render_stats {
+    unsigned int commands;      /* nk_draw_commands produced by nk_convert */
+    unsigned int batches;       /* SDL_RenderGeometryRaw submissions */
+    unsigned int vertices;      /* vertices handed to SDL */
+    unsigned int clip_changes;  /* SDL_RenderSetClipRect calls issued */
+    unsigned int texture_changes;
+    unsigned int state_changes_avoided; /* clip updates dropped as redundant */
+    float convert_ms;           /* calling thread: conversion, or snapshot and wait when pipelined */
+    float draw_ms;              /* batching and SDL submission */
+};
+
+NK_API void                 nk_sdl_render_stats(struct nk_sdl_render_stats *stats);
+
+/* Partial redraw: the UI is rendered into a persistent target texture and
+ * only the rects whose commands changed since the last frame are redrawn
+ * before the target is copied to the screen. The overlay tints the damaged
+ * rects of the current frame.
+ */
+#ifndef NK_SDL_MAX_DAMAGE_RECTS
+#define NK_SDL_MAX_DAMAGE_RECTS 16
+#endif
+
+struct nk_sdl_damage_stats {
+    unsigned int rects;         /* damaged rects redrawn last frame */
+    float coverage;             /* fraction of the screen they cover */
+};
+
+NK_API void                 nk_sdl_set_partial_redraw(int enable);
+NK_API void                 nk_sdl_set_damage_overlay(int enable);
+NK_API void                 nk_sdl_damage_stats(struct nk_sdl_damage_stats *stats);
+
+/* Window cache: windows that are inactive, not hovered and unchanged for
+ * NK_SDL_WINDOW_CACHE_DELAY frames are rendered once into a texture, keyed by
+ * name, theme version, bounds, scroll offsets and contents, and blitted on
+ * later frames instead of being converted and drawn again.
+ */
+#ifndef NK_SDL_WINDOW_CACHE_SIZE
+#define NK_SDL_WINDOW_CACHE_SIZE 16
+#endif
+#ifndef NK_SDL_WINDOW_CACHE_DELAY
+#define NK_SDL_WINDOW_CACHE_DELAY 2
+#endif
+
+struct nk_sdl_window_cache_stats {
+    unsigned int cached;        /* windows drawn from their texture last frame */
+    unsigned int hits;          /* of those, how many reused an existing texture */
+    unsigned int fills;         /* textures (re)rendered last frame */
+};
+
+NK_API void                 nk_sdl_set_window_cache(int enable);
+NK_API void                 nk_sdl_set_theme_version(unsigned int version);
+NK_API void                 nk_sdl_window_cache_stats(struct nk_sdl_window_cache_stats *stats);
+
+/* Pipelined rendering: nk_sdl_render() snapshots the command stream into one
+ * of two slots and hands it to a worker thread that runs nk_convert into the
+ * slot's own buffers, while the UI thread goes on with the next frame's input
+ * and layout. The frame converted during the previous call is batched and
+ * submitted to SDL on the calling thread, so the output lags the UI by one
+ * frame. Partial redraw and the window cache are not used while it is on.
+ */
+struct nk_sdl_pipeline_stats {
+    float build_ms;             /* UI thread: input and layout since the last render */
+    float snapshot_ms;          /* copying the command stream into a slot */
+    float convert_ms;           /* worker: nk_convert of the frame */
+    float wait_ms;              /* UI thread blocked on the worker */
+    float submit_ms;            /* batching and SDL submission */
+};
+
+NK_API void                 nk_sdl_set_pipelined(int enable);
+NK_API void                 nk_sdl_pipeline_stats(struct nk_sdl_pipeline_stats *last, struct nk_sdl_pipeline_stats *average);
+
+/* Native commands: instead of nk_convert, the command stream is walked
+ * directly. Unrounded filled and outlined rects, axis-aligned lines, text and
+ * images become plain quads without anti-aliasing fringes; curves, circles,
+ * arcs, triangles, polygons and rounded rects are still tessellated. Can be
+ * switched at any time to compare both paths.
+ */
+NK_API void                 nk_sdl_set_native_commands(int enable);
+
+/* Tessellation quality: every profile except FIXED sizes circle, arc and curve
+ * segment counts from the primitive's radius or length in output pixels (DPI
+ * scale included) and draws unrounded rects without anti-aliasing fringes.
+ * FAST also turns anti-aliasing off. With a frame budget set, FAST is used
+ * while frames keep going over it.
+ */
+enum nk_sdl_quality {
+    NK_SDL_QUALITY_FIXED,       /* nk_convert with 22 segments everywhere */
+    NK_SDL_QUALITY_HIGH,
+    NK_SDL_QUALITY_BALANCED,
+    NK_SDL_QUALITY_FAST,
+    NK_SDL_QUALITY_COUNT
+};
+
+#ifndef NK_SDL_QUALITY_MAX_SEGMENTS
+#define NK_SDL_QUALITY_MAX_SEGMENTS 64
+#endif
+#ifndef NK_SDL_QUALITY_OVER_FRAMES
+#define NK_SDL_QUALITY_OVER_FRAMES 10       /* frames over budget before going FAST */
+#endif
+#ifndef NK_SDL_QUALITY_RECOVER_FRAMES
+#define NK_SDL_QUALITY_RECOVER_FRAMES 300   /* frames under half the budget before going back */
+#endif
+
+struct nk_sdl_quality_stats {
+    enum nk_sdl_quality profile;    /* selected profile */
+    enum nk_sdl_quality active;     /* profile in use, FAST while over budget */
+    unsigned int vertices[NK_SDL_QUALITY_COUNT]; /* last frame converted with each, 0 if none */
+};
+
+NK_API void                 nk_sdl_set_quality(enum nk_sdl_quality profile);
+NK_API void                 nk_sdl_set_dpi_scale(float scale);
+NK_API void                 nk_sdl_set_frame_budget(float ms);
+NK_API void                 nk_sdl_report_frame_time(float ms);
+NK_API void                 nk_sdl_quality_stats(struct nk_sdl_quality_stats *stats);
+NK_API const char*          nk_sdl_quality_name(enum nk_sdl_quality profile);
+
+/* Memory: the context's command memory, its window pool, the draw command,
+ * vertex and element buffers and the font atlas each allocate through their
+ * own counting allocator. "used" is sampled with nk_buffer_info() whenever a
+ * frame is rendered, "reserved" is what a region currently holds from the heap.
+ */
+enum nk_sdl_memory_region {
+    NK_SDL_MEMORY_CONTEXT,      /* nk_context command memory, pipeline snapshots */
+    NK_SDL_MEMORY_POOL,         /* nk_context windows, panels and tables */
+    NK_SDL_MEMORY_COMMANDS,     /* nk_draw_commands from nk_convert */
+    NK_SDL_MEMORY_VERTICES,
+    NK_SDL_MEMORY_ELEMENTS,
+    NK_SDL_MEMORY_FONT,         /* font atlas: glyphs and fonts, pixels while baking */
+    NK_SDL_MEMORY_COUNT
+};
+
+struct nk_sdl_memory_stats {
+    nk_size used;               /* bytes in use by the last rendered frame */
+    nk_size used_peak;
+    nk_size reserved;           /* bytes currently held from the heap */
+    nk_size reserved_peak;
+    unsigned long allocs;       /* heap allocations so far */
+    unsigned long frees;
+    unsigned long frame_allocs; /* heap allocations since the previous rendered frame */
+};
+
+/* stats receives NK_SDL_MEMORY_COUNT entries */
+NK_API void                 nk_sdl_memory_stats(struct nk_sdl_memory_stats *stats);
+NK_API const char*          nk_sdl_memory_region_name(enum nk_sdl_memory_region region);
+
+/* Arena: when nk_sdl_set_arena() is called before nk_sdl_init(), every region
+ * but FONT takes its memory from one block allocated up front, so once the
+ * block covers the peaks above, no frame reaches malloc. Freed memory is only
+ * reused if it was the last block handed out, so size it at about twice the
+ * reserved peaks; allocations that do not fit fall back to malloc and count as
+ * overflows. Buffers are never shrunk while the arena is in use.
+ */
+struct nk_sdl_arena_stats {
+    nk_size size;
+    nk_size used;
+    nk_size peak;
+    unsigned long overflows;
+};
+
+NK_API void                 nk_sdl_set_arena(nk_size size);
+NK_API void                 nk_sdl_arena_stats(struct nk_sdl_arena_stats *stats);
+
+/* Font atlas cache: nk_sdl_font_stash_end() looks in the cache directory for
+ * a file named after a hash of the atlas setup: font data, pixel sizes (which
+ * include the DPI scale), glyph ranges, oversampling and the nuklear version.
+ * On a hit the RGBA pixels and glyph metrics are mapped from the file and
+ * nk_font_atlas_bake() is skipped, on a miss the baked atlas is written there.
+ * The directory must exist; NULL, the default, disables the cache.
+ */
+#ifndef NK_SDL_FONT_CACHE_NK_VERSION
+#define NK_SDL_FONT_CACHE_NK_VERSION "4.12.0"  /* of nuklear.h, the glyph layout may change */
+#endif
+
+struct nk_sdl_font_cache_stats {
+    int hit;                    /* atlas loaded from the cache */
+    int stored;                 /* baked and written to the cache */
+    float ms;                   /* nk_sdl_font_stash_end() */
+};
+
+NK_API void                 nk_sdl_set_font_cache(const char *dir);
+NK_API void                 nk_sdl_font_cache_stats(struct nk_sdl_font_cache_stats *stats);
+
+/* Read-only file mapping (mmap, MapViewOfFile on Windows) as used by the font
+ * cache, for other binary files of the app. nk_sdl_map_file() returns 0 for a
+ * missing or empty file. */
+struct nk_sdl_file_map {
+    const nk_byte *data;
+    nk_size size;
+};
+
+NK_API int                  nk_sdl_map_file(struct nk_sdl_file_map *map, const char *path);
+NK_API void                 nk_sdl_unmap_file(struct nk_sdl_file_map *map);
+
+/* Lazy glyphs: with nk_sdl_set_lazy_glyphs(1) before nk_sdl_font_stash_end(),
+ * only the configured ranges are baked up front (keep them small, e.g. ASCII).
+ * A codepoint outside them is rasterized with stb_truetype the first time text
+ * is measured with it, packed into rows below the baked atlas and uploaded as
+ * a single rect. When the rows are full the texture doubles the lazy area. Only
+ * the first font of a merged set is searched for lazy glyphs.
+ */
+#ifndef NK_SDL_GLYPH_CACHE_SIZE
+#define NK_SDL_GLYPH_CACHE_SIZE 4096        /* lazy glyphs per font, a power of two */
+#endif
+#ifndef NK_SDL_GLYPH_PAGE_HEIGHT
+#define NK_SDL_GLYPH_PAGE_HEIGHT 64         /* texture rows first reserved for lazy glyphs */
+#endif
+
+struct nk_sdl_glyph_stats {
+    unsigned long hits;         /* glyph lookups served by baked or lazy glyphs */
+    unsigned long misses;       /* lookups that had to rasterize */
+    int baked;                  /* glyphs of the up-front bake */
+    int lazy;                   /* glyphs rasterized since */
+    int missing;                /* codepoints the font has no glyph for */
+    int uploads;                /* partial texture updates */
+    int grows;                  /* texture reallocations */
+    int width, height;          /* of the font texture */
+};
+
+NK_API void                 nk_sdl_set_lazy_glyphs(int enable);
+NK_API void                 nk_sdl_glyph_stats(struct nk_sdl_glyph_stats *stats);
+
+/* Font re-bake, e.g. for a new display scale: nk_sdl_font_rebake() hands a
+ * fresh atlas to setup on a background thread, which adds the fonts; they are
+ * then loaded from the font cache or baked there while frames keep drawing
+ * with the current atlas. Call nk_sdl_font_rebake_poll() once per frame before
+ * the UI pass: when the bake is done it swaps the new atlas in and returns it,
+ * else it returns NULL; the old fonts are gone then, so set the style font
+ * from the new atlas. nk_sdl_font_rebake() returns 0 if a re-bake is running.
+ */
+typedef void (*nk_sdl_font_setup)(struct nk_font_atlas *atlas, void *userdata);
+
+NK_API int                  nk_sdl_font_rebake(nk_sdl_font_setup setup, void *userdata);
+NK_API int                  nk_sdl_font_rebaking(void);
+NK_API struct nk_font_atlas* nk_sdl_font_rebake_poll(void);
+
+/* Tracing hooks: spans around the render phases and the pipeline worker.
+ * Define them before including this file to record the spans; every BEGIN is
+ * closed by an END in the same function. */
+#ifndef NK_SDL_TRACE_BEGIN
+#define NK_SDL_TRACE_BEGIN(name)
+#endif
+#ifndef NK_SDL_TRACE_END
+#define NK_SDL_TRACE_END()
+#endif
+#ifndef NK_SDL_TRACE_THREAD
+#define NK_SDL_TRACE_THREAD(name)
+#endif
+
 #if SDL_COMPILEDVERSION < SDL_VERSIONNUM(2, 0, 22)
 /* Metal API does not support cliprects with negative coordinates or large
  * dimensions. The issue is fixed in SDL2 with version 2.0.22 but until
@@ -31,52 +335,2097 @@ NK_API void                 nk_sdl_shutdown(void);
 
 #endif /* NK_SDL_RENDERER_H_ */
 
-/*
- * ==============================================================
- *
- *                          IMPLEMENTATION
- *
- * ===============================================================
- */
-#ifdef NK_SDL_RENDERER_IMPLEMENTATION
+/*
+ * ==============================================================
+ *
+ *                          IMPLEMENTATION
+ *
+ * ===============================================================
+ */
+#ifdef NK_SDL_RENDERER_IMPLEMENTATION
+
+#include <string>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define NK_SDL_MEMORY_HEADER 16     /* size prefix, keeps malloc's alignment */
+
+struct nk_sdl_memory_counter {
+    SDL_atomic_t bytes, peak;   /* reserved, updated by the pipeline worker too */
+    SDL_atomic_t allocs, frees;
+    int frame_start;            /* allocs at the previous sample */
+    int arena;                  /* allocates from the arena first */
+};
+
+struct nk_sdl_arena {
+    nk_byte *base;
+    nk_size size, top;
+    struct nk_sdl_arena_stats stats;
+    SDL_SpinLock lock;          /* the pipeline worker allocates too */
+};
+
+struct nk_sdl_memory {
+    struct nk_sdl_arena arena;
+    struct nk_allocator alloc[NK_SDL_MEMORY_COUNT];
+    struct nk_sdl_memory_counter counters[NK_SDL_MEMORY_COUNT];
+    struct nk_sdl_memory_stats stats[NK_SDL_MEMORY_COUNT];
+};
+
+struct nk_sdl_frame_buffer {
+    struct nk_buffer buf;
+    nk_size initial_size;
+    nk_size high_water;
+    nk_size idle_peak;      /* largest use seen during the current idle run */
+    unsigned int grow_count;
+    unsigned int shrink_count;
+    int idle_frames;
+};
+
+struct nk_sdl_state {
+    struct nk_rect clip;        /* last requested nuklear clip rect */
+    SDL_Rect sdl_clip;          /* clip rect currently set on the renderer */
+    int clip_valid;
+    SDL_Texture *texture;
+};
+
+struct nk_sdl_batch {
+    nk_draw_index *indices;     /* rebased onto first_vertex */
+    unsigned int count;
+    unsigned int first_vertex;
+    unsigned int vertex_count;
+    SDL_Texture *texture;
+    struct nk_rect clip;
+};
+
+struct nk_sdl_damage_item {
+    Uint64 hash;
+    struct nk_rect bounds;
+};
+
+struct nk_sdl_damage {
+    int enabled;
+    int overlay;
+    int full;                   /* redraw everything next frame */
+    SDL_Texture *target;
+    int target_w, target_h;
+    struct nk_rect screen;
+    struct nk_buffer items[2];  /* sorted command fingerprints, this and last frame */
+    int current;
+    Uint64 order;
+    struct nk_rect rects[NK_SDL_MAX_DAMAGE_RECTS];
+    int rect_count;
+    struct nk_sdl_damage_stats stats;
+};
+
+/* private window flags used while a frame is being prepared */
+#define NK_SDL_WINDOW_CACHED        NK_FLAG(28)
+#define NK_SDL_WINDOW_ISOLATED      NK_FLAG(29)
+#define NK_SDL_WINDOW_POPUP_PARKED  NK_FLAG(30)
+
+struct nk_sdl_cached_window {
+    int used;
+    nk_hash name;
+    Uint64 key;
+    int stable;                 /* frames the key has stayed the same */
+    int valid;                  /* texture matches key */
+    unsigned long last_frame;
+    struct nk_rect area;        /* screen area covered by the texture */
+    SDL_Texture *texture;
+    int tex_w, tex_h;
+};
+
+struct nk_sdl_window_cache {
+    int enabled;
+    unsigned int theme_version;
+    SDL_BlendMode blend;        /* premultiplied alpha */
+    struct nk_sdl_cached_window entries[NK_SDL_WINDOW_CACHE_SIZE];
+    struct nk_sdl_cached_window *order[NK_SDL_WINDOW_CACHE_SIZE];
+    int count;                  /* windows blitted this frame, bottom to top */
+    struct nk_sdl_window_cache_stats stats;
+};
+
+struct nk_sdl_quality_state {
+    enum nk_sdl_quality profile;
+    enum nk_sdl_quality active;
+    float scale;
+    float budget_ms;
+    int over, under;            /* consecutive frames over / well under budget */
+    unsigned int vertices[NK_SDL_QUALITY_COUNT];
+};
+
+struct nk_sdl_pipeline_slot {
+    struct nk_context ctx;      /* shadow context, its memory holds the snapshot */
+    struct nk_window win;       /* single window spanning the whole snapshot */
+    struct nk_buffer cmds;
+    struct nk_sdl_frame_buffer vbuf, ebuf;
+    nk_size vbuf_size, ebuf_size; /* capacities before the conversion */
+    enum nk_anti_aliasing aa;
+    enum nk_sdl_quality quality;
+    float scale;                /* DPI scale the quality profile is measured in */
+    int native;
+    float convert_ms;
+};
+
+struct nk_sdl_pipeline {
+    int enabled;
+    int quit;
+    int drain;                  /* frame unchanged, only submit the pending slot */
+    SDL_Thread *thread;
+    SDL_sem *work, *done;
+    struct nk_sdl_pipeline_slot slots[2];
+    struct nk_sdl_pipeline_slot *job;     /* slot handed to the worker */
+    struct nk_sdl_pipeline_slot *pending; /* converting, submitted next frame */
+    Uint64 render_end;
+    struct nk_sdl_pipeline_stats last, total;
+    unsigned long frames;
+};
+
+struct nk_sdl_device {
+    struct nk_buffer cmds;
+    struct nk_allocator alloc;
+    struct nk_sdl_frame_buffer vbuf, ebuf;
+    int shrink_frames;
+    Uint64 frame_hash;
+    int frame_valid;
+    struct nk_sdl_frame_stats frames;
+    struct nk_sdl_render_stats render;
+    struct nk_sdl_state state;
+    struct nk_buffer batches;
+    unsigned int batch_count;
+    struct nk_sdl_damage damage;
+    struct nk_sdl_window_cache wcache;
+    struct nk_sdl_pipeline pipe;
+    int frame_begun;
+    int native;
+    struct nk_sdl_quality_state quality;
+    struct nk_sdl_memory memory;
+    enum nk_anti_aliasing aa;
+    struct nk_draw_null_texture tex_null;
+    SDL_Texture *font_tex;
+};
+
+struct nk_sdl_vertex {
+    float position[2];
+    float uv[2];
+    nk_byte col[4];
+};
+
+#define NK_SDL_FONT_CACHE_MAGIC 0x43464b4eu   /* "NKFC" */
+#define NK_SDL_FONT_CACHE_FORMAT 1
+
+/* File layout: header, one entry per font, the glyphs, then RGBA pixels. */
+struct nk_sdl_font_cache_header {
+    Uint32 magic;
+    Uint32 format;
+    Uint64 key;
+    Uint32 width, height;
+    Uint32 font_count, glyph_count;
+    struct nk_recti custom;
+    struct nk_cursor cursors[NK_CURSOR_COUNT];
+};
+
+struct nk_sdl_font_cache_font {
+    float height, ascent, descent;
+    Uint32 glyph_offset, glyph_count;
+};
+
+struct nk_sdl_font_cache {
+    char dir[512];
+    struct nk_sdl_font_cache_stats stats;
+};
+
+struct nk_sdl_lazy_glyph {
+    nk_rune codepoint;
+    int missing;                /* not in the font, the fallback glyph is used */
+    struct nk_font_glyph glyph;
+};
+
+/* Lazy glyphs of one font, the font handle's userdata points here. Entries
+ * are only appended, so the pipeline worker can look up the ones recorded
+ * before its snapshot while the UI pass adds more. */
+struct nk_sdl_lazy_font {
+    struct nk_font *font;
+    stbtt_fontinfo info;
+    float scale;
+    struct nk_sdl_lazy_glyph *glyphs;   /* NK_SDL_GLYPH_CACHE_SIZE, allocated on the first miss */
+    int *table;                         /* open addressing, glyph index + 1 */
+    int count;
+};
+
+struct nk_sdl_glyph_cache {
+    int enabled;
+    struct nk_sdl_lazy_font *fonts;
+    int font_count;
+    nk_byte *pixels;            /* copy of the texture, RGBA */
+    int width, height;
+    int top;                    /* first row below the baked atlas */
+    int x, y, row;              /* shelf packer: cursor and height of the current row */
+    struct nk_sdl_glyph_stats stats;
+};
+
+/* an atlas ready for upload */
+struct nk_sdl_font_bake {
+    const void *image;          /* RGBA, baked or in the mapping */
+    struct nk_sdl_file_map map;
+    struct nk_sdl_font_cache_stats stats;
+};
+
+struct nk_sdl_font_rebake {
+    SDL_Thread *thread;
+    SDL_atomic_t done;
+    nk_sdl_font_setup setup;
+    void *userdata;
+    struct nk_font_atlas atlas;
+    struct nk_sdl_font_bake bake;
+};
+
+static struct nk_sdl {
+    SDL_Window *win;
+    SDL_Renderer *renderer;
+    struct nk_sdl_device ogl;
+    struct nk_context ctx;
+    struct nk_font_atlas atlas;
+    struct nk_sdl_font_cache font_cache;
+    struct nk_sdl_glyph_cache glyphs;
+    struct nk_sdl_font_rebake rebake;
+} sdl;
+
+
+
+NK_INTERN void
+nk_sdl_device_upload_atlas(const void *image, int width, int height)
+{
+    struct nk_sdl_device *dev = &sdl.ogl;
+    struct nk_sdl_glyph_cache *glyphs = &sdl.glyphs;
+    struct nk_allocator *alloc = &dev->memory.alloc[NK_SDL_MEMORY_FONT];
+    int tex_height = height;
+    SDL_Texture *g_SDLFontTexture;
+
+    if (glyphs->enabled) {
+        /* room for lazy glyphs below the atlas, and a copy to grow from */
+        tex_height = height + 1 + NK_SDL_GLYPH_PAGE_HEIGHT;
+        glyphs->pixels = (nk_byte*)alloc->alloc(alloc->userdata, 0, (nk_size)width * tex_height * 4);
+        if (glyphs->pixels) {
+            NK_MEMCPY(glyphs->pixels, image, (nk_size)width * height * 4);
+            NK_MEMSET(glyphs->pixels + (nk_size)width * height * 4, 0, (nk_size)width * (tex_height - height) * 4);
+            glyphs->width = width;
+            glyphs->height = tex_height;
+            glyphs->top = glyphs->y = height + 1;
+            glyphs->x = glyphs->row = 0;
+            image = glyphs->pixels;
+        } else {
+            glyphs->enabled = 0;
+            tex_height = height;
+        }
+    }
+
+    g_SDLFontTexture = SDL_CreateTexture(sdl.renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, width, tex_height);
+    if (g_SDLFontTexture == NULL) {
+        SDL_Log("error creating texture");
+        return;
+    }
+    SDL_UpdateTexture(g_SDLFontTexture, NULL, image, 4 * width);
+    SDL_SetTextureBlendMode(g_SDLFontTexture, SDL_BLENDMODE_BLEND);
+    dev->font_tex = g_SDLFontTexture;
+}
+
+NK_INTERN nk_byte*
+nk_sdl_arena_alloc(struct nk_sdl_arena *arena, nk_size size)
+{
+    nk_byte *block = NULL;
+    size = (size + NK_SDL_MEMORY_HEADER - 1) & ~(nk_size)(NK_SDL_MEMORY_HEADER - 1);
+    SDL_AtomicLock(&arena->lock);
+    if (arena->size - arena->top >= size) {
+        block = arena->base + arena->top;
+        arena->top += size;
+        if (arena->top > arena->stats.peak) arena->stats.peak = arena->top;
+    } else arena->stats.overflows++;
+    SDL_AtomicUnlock(&arena->lock);
+    return block;
+}
+
+/* Returns 0 if the block is not from the arena. */
+NK_INTERN int
+nk_sdl_arena_free(struct nk_sdl_arena *arena, nk_byte *block, nk_size size)
+{
+    if (block < arena->base || block >= arena->base + arena->size) return 0;
+    size = (size + NK_SDL_MEMORY_HEADER - 1) & ~(nk_size)(NK_SDL_MEMORY_HEADER - 1);
+    SDL_AtomicLock(&arena->lock);
+    if (block + size == arena->base + arena->top)
+        arena->top -= size;
+    SDL_AtomicUnlock(&arena->lock);
+    return 1;
+}
+
+NK_INTERN void*
+nk_sdl_memory_alloc(nk_handle handle, void *old, nk_size size)
+{
+    struct nk_sdl_memory_counter *c = (struct nk_sdl_memory_counter*)handle.ptr;
+    struct nk_sdl_arena *arena = &sdl.ogl.memory.arena;
+    nk_byte *block = NULL;
+    int bytes, peak;
+    NK_UNUSED(old);
+    if (c->arena && arena->base)
+        block = nk_sdl_arena_alloc(arena, size + NK_SDL_MEMORY_HEADER);
+    if (!block)
+        block = (nk_byte*)malloc(size + NK_SDL_MEMORY_HEADER);
+    if (!block) return NULL;
+    *(nk_size*)block = size;
+    bytes = SDL_AtomicAdd(&c->bytes, (int)size) + (int)size;
+    SDL_AtomicIncRef(&c->allocs);
+    do peak = SDL_AtomicGet(&c->peak);
+    while (bytes > peak && !SDL_AtomicCAS(&c->peak, peak, bytes));
+    return block + NK_SDL_MEMORY_HEADER;
+}
+
+NK_INTERN void
+nk_sdl_memory_free(nk_handle handle, void *ptr)
+{
+    struct nk_sdl_memory_counter *c = (struct nk_sdl_memory_counter*)handle.ptr;
+    nk_byte *block;
+    if (!ptr) return;
+    block = (nk_byte*)ptr - NK_SDL_MEMORY_HEADER;
+    SDL_AtomicAdd(&c->bytes, -(int)*(nk_size*)block);
+    SDL_AtomicIncRef(&c->frees);
+    if (!nk_sdl_arena_free(&sdl.ogl.memory.arena, block, *(nk_size*)block + NK_SDL_MEMORY_HEADER))
+        free(block);
+}
+
+NK_API void
+nk_sdl_set_arena(nk_size size)
+{
+    struct nk_sdl_arena *arena = &sdl.ogl.memory.arena;
+    if (arena->base) return; /* too late, nk_sdl_init already ran */
+    arena->size = size;
+}
+
+NK_API void
+nk_sdl_arena_stats(struct nk_sdl_arena_stats *stats)
+{
+    struct nk_sdl_arena *arena = &sdl.ogl.memory.arena;
+    SDL_AtomicLock(&arena->lock);
+    *stats = arena->stats;
+    stats->size = arena->size;
+    stats->used = arena->top;
+    SDL_AtomicUnlock(&arena->lock);
+}
+
+/* Samples what the frame used. When pipelined, only called while the worker
+ * is idle, as it writes to the buffers passed in. */
+NK_INTERN void
+nk_sdl_memory_sample(struct nk_buffer *cmds, struct nk_buffer *vbuf, struct nk_buffer *ebuf)
+{
+    struct nk_sdl_memory *mem = &sdl.ogl.memory;
+    struct nk_memory_status status;
+    nk_size used[NK_SDL_MEMORY_COUNT];
+    const struct nk_page *page;
+    const struct nk_page_element *elem;
+    nk_size elements = 0;
+    int i;
+
+    nk_buffer_info(&status, &sdl.ctx.memory);
+    used[NK_SDL_MEMORY_CONTEXT] = status.needed;
+    for (page = sdl.ctx.pool.pages; page; page = page->next)
+        elements += page->size;
+    for (elem = sdl.ctx.freelist; elem; elem = elem->next)
+        elements--;
+    used[NK_SDL_MEMORY_POOL] = elements * sizeof(struct nk_page_element);
+    nk_buffer_info(&status, cmds);
+    used[NK_SDL_MEMORY_COMMANDS] = status.needed;
+    nk_buffer_info(&status, vbuf);
+    used[NK_SDL_MEMORY_VERTICES] = status.needed;
+    nk_buffer_info(&status, ebuf);
+    used[NK_SDL_MEMORY_ELEMENTS] = status.needed;
+    used[NK_SDL_MEMORY_FONT] = (nk_size)SDL_AtomicGet(&mem->counters[NK_SDL_MEMORY_FONT].bytes);
+
+    for (i = 0; i < NK_SDL_MEMORY_COUNT; ++i) {
+        struct nk_sdl_memory_stats *s = &mem->stats[i];
+        int allocs = SDL_AtomicGet(&mem->counters[i].allocs);
+        s->used = used[i];
+        if (used[i] > s->used_peak) s->used_peak = used[i];
+        s->frame_allocs = (unsigned long)(allocs - mem->counters[i].frame_start);
+        mem->counters[i].frame_start = allocs;
+    }
+}
+
+NK_API void
+nk_sdl_memory_stats(struct nk_sdl_memory_stats *stats)
+{
+    struct nk_sdl_memory *mem = &sdl.ogl.memory;
+    int i;
+    for (i = 0; i < NK_SDL_MEMORY_COUNT; ++i) {
+        stats[i] = mem->stats[i];
+        stats[i].reserved = (nk_size)SDL_AtomicGet(&mem->counters[i].bytes);
+        stats[i].reserved_peak = (nk_size)SDL_AtomicGet(&mem->counters[i].peak);
+        stats[i].allocs = (unsigned long)SDL_AtomicGet(&mem->counters[i].allocs);
+        stats[i].frees = (unsigned long)SDL_AtomicGet(&mem->counters[i].frees);
+    }
+}
+
+NK_API const char*
+nk_sdl_memory_region_name(enum nk_sdl_memory_region region)
+{
+    static const char *names[NK_SDL_MEMORY_COUNT] = {
+        "context", "pool", "commands", "vertices", "elements", "font"
+    };
+    return (unsigned int)region < NK_SDL_MEMORY_COUNT ? names[region] : "";
+}
+
+NK_INTERN void
+nk_sdl_frame_buffer_init(struct nk_sdl_frame_buffer *fb, enum nk_sdl_memory_region region, nk_size size)
+{
+    struct nk_sdl_device *dev = &sdl.ogl;
+    NK_MEMSET(fb, 0, sizeof(*fb));
+    fb->initial_size = size;
+    nk_buffer_init(&fb->buf, &dev->memory.alloc[region], size);
+}
+
+NK_INTERN void
+nk_sdl_frame_buffer_update(struct nk_sdl_frame_buffer *fb, nk_size size_before)
+{
+    struct nk_sdl_device *dev = &sdl.ogl;
+    nk_size used = fb->buf.needed;
+    nk_size size = fb->buf.memory.size;
+
+    if (size > size_before) fb->grow_count++;
+    if (used > fb->high_water) fb->high_water = used;
+
+    /* a frame counts as idle for this buffer if it used less than a quarter of it;
+     * arena memory is not given back, so there is no point in shrinking */
+    if (dev->shrink_frames <= 0 || dev->memory.arena.base || size <= fb->initial_size || used * 4 >= size) {
+        fb->idle_frames = 0;
+        fb->idle_peak = 0;
+        return;
+    }
+    if (used > fb->idle_peak) fb->idle_peak = used;
+    if (++fb->idle_frames < dev->shrink_frames) return;
+
+    {
+        nk_size target = NK_MAX(fb->initial_size, (nk_size)nk_round_up_pow2((nk_uint)(fb->idle_peak * 2)));
+        if (target < size) {
+            struct nk_allocator alloc = fb->buf.pool;
+            nk_buffer_free(&fb->buf);
+            nk_buffer_init(&fb->buf, &alloc, target);
+            fb->shrink_count++;
+        }
+    }
+    fb->idle_frames = 0;
+    fb->idle_peak = 0;
+}
+
+NK_API void
+nk_sdl_set_buffer_shrink_frames(int frames)
+{
+    sdl.ogl.shrink_frames = frames;
+}
+
+NK_API void
+nk_sdl_buffer_stats(struct nk_sdl_buffer_stats *vertices, struct nk_sdl_buffer_stats *elements)
+{
+    struct nk_sdl_device *dev = &sdl.ogl;
+    struct nk_sdl_buffer_stats *out[2];
+    const struct nk_sdl_frame_buffer *src[2];
+    int i;
+
+    out[0] = vertices; src[0] = &dev->vbuf;
+    out[1] = elements; src[1] = &dev->ebuf;
+    for (i = 0; i < 2; ++i) {
+        if (!out[i]) continue;
+        out[i]->size = src[i]->buf.memory.size;
+        out[i]->used = src[i]->buf.needed;
+        out[i]->high_water = src[i]->high_water;
+        out[i]->grow_count = src[i]->grow_count;
+        out[i]->shrink_count = src[i]->shrink_count;
+    }
+}
+
+NK_INTERN nk_size
+nk_sdl_command_size(const struct nk_command *cmd)
+{
+    switch (cmd->type) {
+    case NK_COMMAND_SCISSOR: return sizeof(struct nk_command_scissor);
+    case NK_COMMAND_LINE: return sizeof(struct nk_command_line);
+    case NK_COMMAND_CURVE: return sizeof(struct nk_command_curve);
+    case NK_COMMAND_RECT: return sizeof(struct nk_command_rect);
+    case NK_COMMAND_RECT_FILLED: return sizeof(struct nk_command_rect_filled);
+    case NK_COMMAND_RECT_MULTI_COLOR: return sizeof(struct nk_command_rect_multi_color);
+    case NK_COMMAND_CIRCLE: return sizeof(struct nk_command_circle);
+    case NK_COMMAND_CIRCLE_FILLED: return sizeof(struct nk_command_circle_filled);
+    case NK_COMMAND_ARC: return sizeof(struct nk_command_arc);
+    case NK_COMMAND_ARC_FILLED: return sizeof(struct nk_command_arc_filled);
+    case NK_COMMAND_TRIANGLE: return sizeof(struct nk_command_triangle);
+    case NK_COMMAND_TRIANGLE_FILLED: return sizeof(struct nk_command_triangle_filled);
+    case NK_COMMAND_POLYGON: {
+        const struct nk_command_polygon *p = (const struct nk_command_polygon*)cmd;
+        return sizeof(*p) + (nk_size)NK_MAX(p->point_count - 1, 0) * sizeof(struct nk_vec2i);
+    }
+    case NK_COMMAND_POLYGON_FILLED: {
+        const struct nk_command_polygon_filled *p = (const struct nk_command_polygon_filled*)cmd;
+        return sizeof(*p) + (nk_size)NK_MAX(p->point_count - 1, 0) * sizeof(struct nk_vec2i);
+    }
+    case NK_COMMAND_POLYLINE: {
+        const struct nk_command_polyline *p = (const struct nk_command_polyline*)cmd;
+        return sizeof(*p) + (nk_size)NK_MAX(p->point_count - 1, 0) * sizeof(struct nk_vec2i);
+    }
+    case NK_COMMAND_TEXT: {
+        const struct nk_command_text *t = (const struct nk_command_text*)cmd;
+        return NK_OFFSETOF(struct nk_command_text, string) + (nk_size)t->length;
+    }
+    case NK_COMMAND_IMAGE: return sizeof(struct nk_command_image);
+    case NK_COMMAND_CUSTOM: return sizeof(struct nk_command_custom);
+    case NK_COMMAND_NOP:
+    default: return sizeof(struct nk_command);
+    }
+}
+
+NK_INTERN Uint64
+nk_sdl_hash(Uint64 hash, const void *data, nk_size size)
+{
+    /* FNV-1a */
+    const nk_byte *p = (const nk_byte*)data;
+    while (size--) {
+        hash ^= *p++;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+NK_INTERN void nk_sdl_frame_begin(void);
+NK_INTERN void nk_sdl_frame_end(void);
+
+NK_API int
+nk_sdl_frame_changed(void)
+{
+    struct nk_sdl_device *dev = &sdl.ogl;
+    const struct nk_command *cmd;
+    Uint64 hash = 0xcbf29ce484222325ull;
+    Uint8 clear[4];
+    int size[2];
+
+    nk_sdl_frame_begin();
+
+    /* the header holds buffer offsets, so only the type and payload are hashed */
+    nk_foreach(cmd, &sdl.ctx) {
+        nk_size len = nk_sdl_command_size(cmd);
+        hash = nk_sdl_hash(hash, &cmd->type, sizeof(cmd->type));
+        if (len > sizeof(struct nk_command))
+            hash = nk_sdl_hash(hash, cmd + 1, len - sizeof(struct nk_command));
+    }
+    SDL_GetRenderDrawColor(sdl.renderer, &clear[0], &clear[1], &clear[2], &clear[3]);
+    SDL_GetRendererOutputSize(sdl.renderer, &size[0], &size[1]);
+    hash = nk_sdl_hash(hash, clear, sizeof(clear));
+    hash = nk_sdl_hash(hash, size, sizeof(size));
+
+    if (dev->frame_valid && hash == dev->frame_hash) {
+        /* the pipeline still holds this frame, it has to reach the screen */
+        if (dev->pipe.pending) {
+            dev->pipe.drain = 1;
+            return 1;
+        }
+        return 0;
+    }
+    dev->frame_hash = hash;
+    dev->frame_valid = 1;
+    return 1;
+}
+
+NK_API void
+nk_sdl_skip_frame(void)
+{
+    nk_sdl_frame_end();
+    sdl.ogl.frames.skipped++;
+}
+
+NK_API void
+nk_sdl_invalidate(void)
+{
+    sdl.ogl.frame_valid = 0;
+    sdl.ogl.damage.full = 1;
+}
+
+NK_API void
+nk_sdl_frame_stats(struct nk_sdl_frame_stats *stats)
+{
+    *stats = sdl.ogl.frames;
+}
+
+NK_API void
+nk_sdl_render_stats(struct nk_sdl_render_stats *stats)
+{
+    *stats = sdl.ogl.render;
+}
+
+NK_INTERN int
+nk_sdl_rect_equal(const struct nk_rect *a, const struct nk_rect *b)
+{
+    return a->x == b->x && a->y == b->y && a->w == b->w && a->h == b->h;
+}
+
+NK_INTERN struct nk_rect
+nk_sdl_rect_intersect(struct nk_rect a, struct nk_rect b)
+{
+    float x0 = NK_MAX(a.x, b.x), y0 = NK_MAX(a.y, b.y);
+    float x1 = NK_MIN(a.x + a.w, b.x + b.w), y1 = NK_MIN(a.y + a.h, b.y + b.h);
+    return nk_rect(x0, y0, NK_MAX(0.0f, x1 - x0), NK_MAX(0.0f, y1 - y0));
+}
+
+NK_INTERN struct nk_rect
+nk_sdl_rect_union(struct nk_rect a, struct nk_rect b)
+{
+    float x0 = NK_MIN(a.x, b.x), y0 = NK_MIN(a.y, b.y);
+    float x1 = NK_MAX(a.x + a.w, b.x + b.w), y1 = NK_MAX(a.y + a.h, b.y + b.h);
+    return nk_rect(x0, y0, x1 - x0, y1 - y0);
+}
+
+NK_INTERN void
+nk_sdl_set_clip(const struct nk_rect *clip, const SDL_Rect *viewport)
+{
+    struct nk_sdl_device *dev = &sdl.ogl;
+    struct nk_sdl_state *state = &dev->state;
+    SDL_Rect r;
+
+    if (state->clip_valid && nk_sdl_rect_equal(clip, &state->clip)) {
+        dev->render.state_changes_avoided++;
+        return;
+    }
+    state->clip = *clip;
+
+    r.x = clip->x;
+    r.y = clip->y;
+    r.w = clip->w;
+    r.h = clip->h;
+#ifdef NK_SDL_CLAMP_CLIP_RECT
+    if (r.x < 0) {
+        r.w += r.x;
+        r.x = 0;
+    }
+    if (r.y < 0) {
+        r.h += r.y;
+        r.y = 0;
+    }
+    if (r.h > viewport->h) {
+        r.h = viewport->h;
+    }
+    if (r.w > viewport->w) {
+        r.w = viewport->w;
+    }
+#else
+    NK_UNUSED(viewport);
+#endif
+    /* different nuklear rects can still map to the same integer rect */
+    if (state->clip_valid && r.x == state->sdl_clip.x && r.y == state->sdl_clip.y &&
+        r.w == state->sdl_clip.w && r.h == state->sdl_clip.h) {
+        dev->render.state_changes_avoided++;
+        return;
+    }
+    SDL_RenderSetClipRect(sdl.renderer, &r);
+    state->sdl_clip = r;
+    state->clip_valid = 1;
+    dev->render.clip_changes++;
+}
+
+NK_INTERN void
+nk_sdl_push_batch(nk_draw_index *indices, unsigned int count, SDL_Texture *texture, struct nk_rect clip)
+{
+    struct nk_sdl_device *dev = &sdl.ogl;
+    struct nk_sdl_batch batch;
+    nk_draw_index lo = indices[0], hi = indices[0];
+    unsigned int i;
+
+    /* rebase the indices onto the range they reference; the element buffer
+     * is rebuilt every frame so it can be modified in place */
+    for (i = 1; i < count; ++i) {
+        lo = NK_MIN(lo, indices[i]);
+        hi = NK_MAX(hi, indices[i]);
+    }
+    if (lo) {
+        for (i = 0; i < count; ++i)
+            indices[i] = (nk_draw_index)(indices[i] - lo);
+    }
+    batch.indices = indices;
+    batch.count = count;
+    batch.first_vertex = lo;
+    batch.vertex_count = (unsigned int)(hi - lo + 1);
+    batch.texture = texture;
+    batch.clip = clip;
+    nk_buffer_push(&dev->batches, NK_BUFFER_FRONT, &batch, sizeof(batch), NK_ALIGNOF(struct nk_sdl_batch));
+    dev->batch_count++;
+}
+
+/* Turns the converted draw list into batches: consecutive commands that share
+ * a texture and clip rect become one submission. */
+NK_INTERN void
+nk_sdl_build_batches(const struct nk_context *ctx, const struct nk_buffer *cmds, nk_draw_index *offset)
+{
+    struct nk_sdl_device *dev = &sdl.ogl;
+    const struct nk_draw_command *cmd;
+    nk_draw_index *batch = NULL;
+    unsigned int batch_count = 0;
+    SDL_Texture *batch_texture = NULL;
+    struct nk_rect batch_clip = nk_rect(0, 0, 0, 0);
+
+    nk_buffer_clear(&dev->batches);
+    dev->batch_count = 0;
+
+    nk_draw_foreach(cmd, ctx, cmds)
+    {
+        if (!cmd->elem_count) continue;
+        dev->render.commands++;
+
+        if (batch_count && cmd->texture.ptr == batch_texture &&
+            nk_sdl_rect_equal(&cmd->clip_rect, &batch_clip)) {
+            batch_count += cmd->elem_count;
+        } else {
+            if (batch_count)
+                nk_sdl_push_batch(batch, batch_count, batch_texture, batch_clip);
+            batch = offset;
+            batch_count = cmd->elem_count;
+            batch_texture = (SDL_Texture *)cmd->texture.ptr;
+            batch_clip = cmd->clip_rect;
+        }
+        offset += cmd->elem_count;
+    }
+    if (batch_count)
+        nk_sdl_push_batch(batch, batch_count, batch_texture, batch_clip);
+}
+
+/* Submits all batches, restricted to region if one is given. */
+NK_INTERN void
+nk_sdl_draw_batches(const void *vertices, const struct nk_rect *region, const SDL_Rect *viewport)
+{
+    struct nk_sdl_device *dev = &sdl.ogl;
+    const struct nk_sdl_batch *batch = (const struct nk_sdl_batch*)nk_buffer_memory_const(&dev->batches);
+    int vs = sizeof(struct nk_sdl_vertex);
+    size_t vp = offsetof(struct nk_sdl_vertex, position);
+    size_t vt = offsetof(struct nk_sdl_vertex, uv);
+    size_t vc = offsetof(struct nk_sdl_vertex, col);
+    unsigned int i;
+
+    for (i = 0; i < dev->batch_count; ++i, ++batch) {
+        const nk_byte *first = (const nk_byte*)vertices + (nk_size)batch->first_vertex * vs;
+        struct nk_rect clip = batch->clip;
+
+        if (region) {
+            clip = nk_sdl_rect_intersect(clip, *region);
+            if (clip.w <= 0 || clip.h <= 0) continue;
+        }
+        nk_sdl_set_clip(&clip, viewport);
+
+        SDL_RenderGeometryRaw(sdl.renderer, batch->texture,
+                (const float*)(first + vp), vs,
+                (const SDL_Color*)(first + vc), vs,
+                (const float*)(first + vt), vs,
+                (int)batch->vertex_count,
+                (const void *) batch->indices, (int)batch->count, sizeof(nk_draw_index));
+
+        dev->render.batches++;
+        dev->render.vertices += batch->vertex_count;
+        if (batch->texture != dev->state.texture) {
+            dev->render.texture_changes++;
+            dev->state.texture = batch->texture;
+        }
+    }
+}
+
+/* Screen-space bounds of a drawing command, 0 for commands that draw nothing. */
+NK_INTERN int
+nk_sdl_command_bounds(const struct nk_command *cmd, struct nk_rect *out)
+{
+    float x0, y0, x1, y1, pad = 0;
+    int i, n = 0;
+    const struct nk_vec2i *pts = NULL;
+
+    switch (cmd->type) {
+    case NK_COMMAND_LINE: {
+        const struct nk_command_line *c = (const struct nk_command_line*)cmd;
+        x0 = NK_MIN(c->begin.x, c->end.x); x1 = NK_MAX(c->begin.x, c->end.x);
+        y0 = NK_MIN(c->begin.y, c->end.y); y1 = NK_MAX(c->begin.y, c->end.y);
+        pad = c->line_thickness;
+    } break;
+    case NK_COMMAND_CURVE: {
+        const struct nk_command_curve *c = (const struct nk_command_curve*)cmd;
+        x0 = NK_MIN(NK_MIN(c->begin.x, c->end.x), NK_MIN(c->ctrl[0].x, c->ctrl[1].x));
+        x1 = NK_MAX(NK_MAX(c->begin.x, c->end.x), NK_MAX(c->ctrl[0].x, c->ctrl[1].x));
+        y0 = NK_MIN(NK_MIN(c->begin.y, c->end.y), NK_MIN(c->ctrl[0].y, c->ctrl[1].y));
+        y1 = NK_MAX(NK_MAX(c->begin.y, c->end.y), NK_MAX(c->ctrl[0].y, c->ctrl[1].y));
+        pad = c->line_thickness;
+    } break;
+    case NK_COMMAND_RECT: {
+        const struct nk_command_rect *c = (const struct nk_command_rect*)cmd;
+        x0 = c->x; y0 = c->y; x1 = c->x + c->w; y1 = c->y + c->h;
+        pad = c->line_thickness;
+    } break;
+    case NK_COMMAND_RECT_FILLED: {
+        const struct nk_command_rect_filled *c = (const struct nk_command_rect_filled*)cmd;
+        x0 = c->x; y0 = c->y; x1 = c->x + c->w; y1 = c->y + c->h;
+    } break;
+    case NK_COMMAND_RECT_MULTI_COLOR: {
+        const struct nk_command_rect_multi_color *c = (const struct nk_command_rect_multi_color*)cmd;
+        x0 = c->x; y0 = c->y; x1 = c->x + c->w; y1 = c->y + c->h;
+    } break;
+    case NK_COMMAND_CIRCLE: {
+        const struct nk_command_circle *c = (const struct nk_command_circle*)cmd;
+        x0 = c->x; y0 = c->y; x1 = c->x + c->w; y1 = c->y + c->h;
+        pad = c->line_thickness;
+    } break;
+    case NK_COMMAND_CIRCLE_FILLED: {
+        const struct nk_command_circle_filled *c = (const struct nk_command_circle_filled*)cmd;
+        x0 = c->x; y0 = c->y; x1 = c->x + c->w; y1 = c->y + c->h;
+    } break;
+    case NK_COMMAND_ARC: {
+        const struct nk_command_arc *c = (const struct nk_command_arc*)cmd;
+        x0 = c->cx - c->r; y0 = c->cy - c->r; x1 = c->cx + c->r; y1 = c->cy + c->r;
+        pad = c->line_thickness;
+    } break;
+    case NK_COMMAND_ARC_FILLED: {
+        const struct nk_command_arc_filled *c = (const struct nk_command_arc_filled*)cmd;
+        x0 = c->cx - c->r; y0 = c->cy - c->r; x1 = c->cx + c->r; y1 = c->cy + c->r;
+    } break;
+    case NK_COMMAND_TRIANGLE: {
+        const struct nk_command_triangle *c = (const struct nk_command_triangle*)cmd;
+        x0 = NK_MIN(c->a.x, NK_MIN(c->b.x, c->c.x)); x1 = NK_MAX(c->a.x, NK_MAX(c->b.x, c->c.x));
+        y0 = NK_MIN(c->a.y, NK_MIN(c->b.y, c->c.y)); y1 = NK_MAX(c->a.y, NK_MAX(c->b.y, c->c.y));
+        pad = c->line_thickness;
+    } break;
+    case NK_COMMAND_TRIANGLE_FILLED: {
+        const struct nk_command_triangle_filled *c = (const struct nk_command_triangle_filled*)cmd;
+        x0 = NK_MIN(c->a.x, NK_MIN(c->b.x, c->c.x)); x1 = NK_MAX(c->a.x, NK_MAX(c->b.x, c->c.x));
+        y0 = NK_MIN(c->a.y, NK_MIN(c->b.y, c->c.y)); y1 = NK_MAX(c->a.y, NK_MAX(c->b.y, c->c.y));
+    } break;
+    case NK_COMMAND_POLYGON: {
+        const struct nk_command_polygon *c = (const struct nk_command_polygon*)cmd;
+        pts = c->points; n = c->point_count; pad = c->line_thickness;
+    } break;
+    case NK_COMMAND_POLYGON_FILLED: {
+        const struct nk_command_polygon_filled *c = (const struct nk_command_polygon_filled*)cmd;
+        pts = c->points; n = c->point_count;
+    } break;
+    case NK_COMMAND_POLYLINE: {
+        const struct nk_command_polyline *c = (const struct nk_command_polyline*)cmd;
+        pts = c->points; n = c->point_count; pad = c->line_thickness;
+    } break;
+    case NK_COMMAND_TEXT: {
+        const struct nk_command_text *c = (const struct nk_command_text*)cmd;
+        x0 = c->x; y0 = c->y; x1 = c->x + c->w; y1 = c->y + c->h;
+    } break;
+    case NK_COMMAND_IMAGE: {
+        const struct nk_command_image *c = (const struct nk_command_image*)cmd;
+        x0 = c->x; y0 = c->y; x1 = c->x + c->w; y1 = c->y + c->h;
+    } break;
+    case NK_COMMAND_CUSTOM: {
+        const struct nk_command_custom *c = (const struct nk_command_custom*)cmd;
+        x0 = c->x; y0 = c->y; x1 = c->x + c->w; y1 = c->y + c->h;
+    } break;
+    case NK_COMMAND_NOP:
+    case NK_COMMAND_SCISSOR:
+    default: return 0;
+    }
+    if (pts) {
+        if (!n) return 0;
+        x0 = x1 = pts[0].x; y0 = y1 = pts[0].y;
+        for (i = 1; i < n; ++i) {
+            x0 = NK_MIN(x0, pts[i].x); x1 = NK_MAX(x1, pts[i].x);
+            y0 = NK_MIN(y0, pts[i].y); y1 = NK_MAX(y1, pts[i].y);
+        }
+    }
+    /* leave room for line width and the anti-aliasing fringe */
+    pad += 2.0f;
+    *out = nk_rect(x0 - pad, y0 - pad, (x1 - x0) + 2 * pad, (y1 - y0) + 2 * pad);
+    return 1;
+}
+
+NK_INTERN int
+nk_sdl_damage_item_cmp(const void *a, const void *b)
+{
+    Uint64 ha = ((const struct nk_sdl_damage_item*)a)->hash;
+    Uint64 hb = ((const struct nk_sdl_damage_item*)b)->hash;
+    return (ha > hb) - (ha < hb);
+}
+
+/* Fingerprints every drawing command of the frame, including the scissor it is
+ * drawn under, and returns an order-sensitive hash of the whole list. */
+NK_INTERN Uint64
+nk_sdl_damage_collect(struct nk_buffer *items)
+{
+    const struct nk_command *cmd;
+    struct nk_rect scissor = nk_rect(-8192.0f, -8192.0f, 16384.0f, 16384.0f);
+    Uint64 order = 0xcbf29ce484222325ull;
+
+    nk_buffer_clear(items);
+    nk_foreach(cmd, &sdl.ctx) {
+        struct nk_sdl_damage_item item;
+        nk_size len;
+
+        if (cmd->type == NK_COMMAND_SCISSOR) {
+            const struct nk_command_scissor *s = (const struct nk_command_scissor*)cmd;
+            scissor = nk_rect(s->x, s->y, s->w, s->h);
+            continue;
+        }
+        if (!nk_sdl_command_bounds(cmd, &item.bounds)) continue;
+        item.bounds = nk_sdl_rect_intersect(item.bounds, scissor);
+        if (item.bounds.w <= 0 || item.bounds.h <= 0) continue;
+
+        len = nk_sdl_command_size(cmd);
+        item.hash = nk_sdl_hash(0xcbf29ce484222325ull, &cmd->type, sizeof(cmd->type));
+        item.hash = nk_sdl_hash(item.hash, &scissor, sizeof(scissor));
+        if (len > sizeof(struct nk_command))
+            item.hash = nk_sdl_hash(item.hash, cmd + 1, len - sizeof(struct nk_command));
+        order = nk_sdl_hash(order, &item.hash, sizeof(item.hash));
+        nk_buffer_push(items, NK_BUFFER_FRONT, &item, sizeof(item), NK_ALIGNOF(struct nk_sdl_damage_item));
+    }
+    return order;
+}
+
+NK_INTERN void
+nk_sdl_damage_add(struct nk_sdl_damage *damage, struct nk_rect r)
+{
+    int i;
+    r = nk_sdl_rect_intersect(r, damage->screen);
+    if (r.w <= 0 || r.h <= 0) return;
+
+    /* fold into an overlapping rect, repeating while the grown rect swallows others */
+    for (i = 0; i < damage->rect_count; ++i) {
+        struct nk_rect o = nk_sdl_rect_intersect(r, damage->rects[i]);
+        if (o.w > 0 && o.h > 0) {
+            r = nk_sdl_rect_union(r, damage->rects[i]);
+            damage->rects[i] = damage->rects[--damage->rect_count];
+            i = -1;
+        }
+    }
+    if (damage->rect_count == NK_SDL_MAX_DAMAGE_RECTS) {
+        for (i = 1; i < damage->rect_count; ++i)
+            damage->rects[0] = nk_sdl_rect_union(damage->rects[0], damage->rects[i]);
+        damage->rects[0] = nk_sdl_rect_union(damage->rects[0], r);
+        damage->rect_count = 1;
+        return;
+    }
+    damage->rects[damage->rect_count++] = r;
+}
+
+/* Computes this frame's damaged rects from the command list and swaps the
+ * fingerprint buffers. Falls back to a single full-screen rect when the
+ * target is new, the frame was invalidated or most of the screen changed. */
+NK_INTERN void
+nk_sdl_damage_compute(struct nk_sdl_damage *damage)
+{
+    struct nk_buffer *cur = &damage->items[damage->current];
+    struct nk_buffer *prev = &damage->items[!damage->current];
+    const struct nk_sdl_damage_item *a, *b;
+    nk_size na, nb, ia = 0, ib = 0;
+    Uint64 order = nk_sdl_damage_collect(cur);
+    float area = 0;
+    int i, full = damage->full;
+
+    damage->rect_count = 0;
+    a = (const struct nk_sdl_damage_item*)nk_buffer_memory_const(cur);
+    b = (const struct nk_sdl_damage_item*)nk_buffer_memory_const(prev);
+    na = cur->allocated / sizeof(*a);
+    nb = prev->allocated / sizeof(*b);
+    qsort(nk_buffer_memory(cur), na, sizeof(*a), nk_sdl_damage_item_cmp);
+
+    /* anything not present in both frames is damage, wherever it was or is now */
+    while (!full && (ia < na || ib < nb)) {
+        if (ib == nb || (ia < na && a[ia].hash < b[ib].hash)) {
+            nk_sdl_damage_add(damage, a[ia++].bounds);
+        } else if (ia == na || b[ib].hash < a[ia].hash) {
+            nk_sdl_damage_add(damage, b[ib++].bounds);
+        } else {
+            ia++; ib++;
+        }
+    }
+    /* same commands in a different order, e.g. windows swapping depth */
+    if (!full && !damage->rect_count && order != damage->order)
+        full = 1;
+
+    for (i = 0; i < damage->rect_count; ++i)
+        area += damage->rects[i].w * damage->rects[i].h;
+    if (full || area > 0.5f * damage->screen.w * damage->screen.h) {
+        damage->rects[0] = damage->screen;
+        damage->rect_count = 1;
+        area = damage->screen.w * damage->screen.h;
+    }
+
+    damage->stats.rects = (unsigned int)damage->rect_count;
+    damage->stats.coverage = area / NK_MAX(1.0f, damage->screen.w * damage->screen.h);
+    damage->order = order;
+    damage->full = 0;
+    damage->current = !damage->current;
+}
+
+/* Makes sure the persistent target exists and matches the output size. */
+NK_INTERN int
+nk_sdl_damage_target(struct nk_sdl_damage *damage)
+{
+    int w, h;
+    if (!SDL_RenderTargetSupported(sdl.renderer))
+        return 0;
+    SDL_GetRendererOutputSize(sdl.renderer, &w, &h);
+    if (damage->target && damage->target_w == w && damage->target_h == h)
+        return 1;
+
+    if (damage->target) SDL_DestroyTexture(damage->target);
+    damage->target = SDL_CreateTexture(sdl.renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, w, h);
+    if (!damage->target) {
+        SDL_Log("error creating render target, partial redraw disabled: %s", SDL_GetError());
+        damage->enabled = 0;
+        return 0;
+    }
+    /* the target holds the finished frame, so it is copied opaque */
+    SDL_SetTextureBlendMode(damage->target, SDL_BLENDMODE_NONE);
+    damage->target_w = w;
+    damage->target_h = h;
+    damage->full = 1;
+    return 1;
+}
+
+NK_INTERN void
+nk_sdl_damage_overlay(const struct nk_sdl_damage *damage)
+{
+    Uint8 r, g, b, a;
+    SDL_BlendMode blend;
+    int i;
+
+    SDL_GetRenderDrawColor(sdl.renderer, &r, &g, &b, &a);
+    SDL_GetRenderDrawBlendMode(sdl.renderer, &blend);
+    SDL_SetRenderDrawBlendMode(sdl.renderer, SDL_BLENDMODE_BLEND);
+    for (i = 0; i < damage->rect_count; ++i) {
+        SDL_FRect f;
+        f.x = damage->rects[i].x; f.y = damage->rects[i].y;
+        f.w = damage->rects[i].w; f.h = damage->rects[i].h;
+        SDL_SetRenderDrawColor(sdl.renderer, 255, 0, 255, 48);
+        SDL_RenderFillRectF(sdl.renderer, &f);
+        SDL_SetRenderDrawColor(sdl.renderer, 255, 0, 255, 192);
+        SDL_RenderDrawRectF(sdl.renderer, &f);
+    }
+    SDL_SetRenderDrawBlendMode(sdl.renderer, blend);
+    SDL_SetRenderDrawColor(sdl.renderer, r, g, b, a);
+}
+
+/* Appends a quad to the draw list, writing the vertices directly. */
+NK_INTERN void
+nk_sdl_native_quad(struct nk_draw_list *list, float x0, float y0, float x1, float y1,
+    struct nk_vec2 uv0, struct nk_vec2 uv1, struct nk_color col)
+{
+    nk_draw_index base = (nk_draw_index)list->vertex_count;
+    struct nk_sdl_vertex *v = (struct nk_sdl_vertex*)nk_draw_list_alloc_vertices(list, 4);
+    nk_draw_index *idx = nk_draw_list_alloc_elements(list, 6);
+    int i;
+
+    if (!v || !idx) return;
+    v[0].position[0] = x0; v[0].position[1] = y0; v[0].uv[0] = uv0.x; v[0].uv[1] = uv0.y;
+    v[1].position[0] = x1; v[1].position[1] = y0; v[1].uv[0] = uv1.x; v[1].uv[1] = uv0.y;
+    v[2].position[0] = x1; v[2].position[1] = y1; v[2].uv[0] = uv1.x; v[2].uv[1] = uv1.y;
+    v[3].position[0] = x0; v[3].position[1] = y1; v[3].uv[0] = uv0.x; v[3].uv[1] = uv1.y;
+    for (i = 0; i < 4; ++i) {
+        v[i].col[0] = col.r; v[i].col[1] = col.g;
+        v[i].col[2] = col.b; v[i].col[3] = col.a;
+    }
+    idx[0] = base; idx[1] = (nk_draw_index)(base + 1); idx[2] = (nk_draw_index)(base + 2);
+    idx[3] = base; idx[4] = (nk_draw_index)(base + 2); idx[5] = (nk_draw_index)(base + 3);
+}
+
+/* Solid quad sampled from the null texture. */
+NK_INTERN void
+nk_sdl_native_fill(struct nk_draw_list *list, float x0, float y0, float x1, float y1, struct nk_color col)
+{
+    struct nk_vec2 uv = list->config.tex_null.uv;
+    if (!list->cmd_count)
+        nk_draw_list_add_clip(list, nk_null_rect);
+    nk_draw_list_push_image(list, list->config.tex_null.texture);
+    nk_sdl_native_quad(list, x0, y0, x1, y1, uv, uv, col);
+}
+
+NK_INTERN void
+nk_sdl_native_text(struct nk_draw_list *list, const struct nk_command_text *t)
+{
+    const struct nk_user_font *font = t->font;
+    struct nk_user_font_glyph g;
+    nk_rune unicode = 0, next = 0;
+    int glyph_len, next_glyph_len, text_len = 0;
+    float x = t->x;
+
+    if (!t->length || !NK_INTERSECT(t->x, t->y, t->w, t->h,
+        list->clip_rect.x, list->clip_rect.y, list->clip_rect.w, list->clip_rect.h)) return;
+
+    nk_draw_list_push_image(list, font->texture);
+    glyph_len = nk_utf_decode(t->string, &unicode, t->length);
+    while (text_len < t->length && glyph_len && unicode != NK_UTF_INVALID) {
+        next_glyph_len = nk_utf_decode(t->string + text_len + glyph_len, &next, t->length - text_len);
+        font->query(font->userdata, t->height, &g, unicode, (next == NK_UTF_INVALID) ? '\0' : next);
+        nk_sdl_native_quad(list, x + g.offset.x, t->y + g.offset.y,
+            x + g.offset.x + g.width, t->y + g.offset.y + g.height, g.uv[0], g.uv[1], t->foreground);
+        text_len += glyph_len;
+        x += g.xadvance;
+        glyph_len = next_glyph_len;
+        unicode = next;
+    }
+}
+
+/* Segments needed for an arc of the given radius and span to stay within the
+ * profile's tolerance of the true curve, in output pixels. */
+NK_INTERN unsigned int
+nk_sdl_arc_segments(enum nk_sdl_quality quality, float scale, float radius, float span, unsigned int fixed)
+{
+    static const float tolerance[NK_SDL_QUALITY_COUNT] = {0, 0.25f, 0.5f, 1.5f};
+    float r = radius * scale, n;
+    unsigned int min = NK_MAX(2u, (unsigned int)SDL_ceilf(span * 4.0f / (2.0f * NK_PI)));
+
+    if (quality == NK_SDL_QUALITY_FIXED) return fixed;
+    if (r <= tolerance[quality]) return min;
+    n = SDL_ceilf(span / (2.0f * SDL_acosf(1.0f - tolerance[quality] / r)));
+    return NK_CLAMP(min, (unsigned int)n, (unsigned int)NK_SDL_QUALITY_MAX_SEGMENTS);
+}
+
+NK_INTERN unsigned int
+nk_sdl_curve_segments(enum nk_sdl_quality quality, float scale, const struct nk_command_curve *q, unsigned int fixed)
+{
+    static const float tolerance[NK_SDL_QUALITY_COUNT] = {0, 0.25f, 0.5f, 1.5f};
+    const struct nk_vec2i *p[4];
+    float length = 0;
+    int i;
+
+    if (quality == NK_SDL_QUALITY_FIXED) return fixed;
+    p[0] = &q->begin; p[1] = &q->ctrl[0]; p[2] = &q->ctrl[1]; p[3] = &q->end;
+    /* the control polygon is never shorter than the curve */
+    for (i = 0; i < 3; ++i) {
+        float dx = (float)(p[i + 1]->x - p[i]->x), dy = (float)(p[i + 1]->y - p[i]->y);
+        length += SDL_sqrtf(dx * dx + dy * dy);
+    }
+    length *= scale;
+    return NK_CLAMP(2u, (unsigned int)SDL_ceilf(SDL_sqrtf(length / (2.0f * tolerance[quality]))),
+        (unsigned int)NK_SDL_QUALITY_MAX_SEGMENTS);
+}
+
+/* Tessellates the primitives the native path has no quad form for, the same
+ * way nk_convert does but with segment counts picked by the quality profile. */
+NK_INTERN void
+nk_sdl_native_tessellate(struct nk_draw_list *list, const struct nk_command *cmd,
+    const struct nk_convert_config *config, enum nk_sdl_quality quality, float scale)
+{
+    int i;
+    switch (cmd->type) {
+    case NK_COMMAND_LINE: {
+        const struct nk_command_line *l = (const struct nk_command_line*)cmd;
+        nk_draw_list_stroke_line(list, nk_vec2(l->begin.x, l->begin.y),
+            nk_vec2(l->end.x, l->end.y), l->color, l->line_thickness);
+    } break;
+    case NK_COMMAND_CURVE: {
+        const struct nk_command_curve *q = (const struct nk_command_curve*)cmd;
+        nk_draw_list_stroke_curve(list, nk_vec2(q->begin.x, q->begin.y),
+            nk_vec2(q->ctrl[0].x, q->ctrl[0].y), nk_vec2(q->ctrl[1].x, q->ctrl[1].y),
+            nk_vec2(q->end.x, q->end.y), q->color,
+            nk_sdl_curve_segments(quality, scale, q, config->curve_segment_count), q->line_thickness);
+    } break;
+    case NK_COMMAND_RECT: {
+        const struct nk_command_rect *r = (const struct nk_command_rect*)cmd;
+        nk_draw_list_stroke_rect(list, nk_rect(r->x, r->y, r->w, r->h),
+            r->color, (float)r->rounding, r->line_thickness);
+    } break;
+    case NK_COMMAND_RECT_FILLED: {
+        const struct nk_command_rect_filled *r = (const struct nk_command_rect_filled*)cmd;
+        nk_draw_list_fill_rect(list, nk_rect(r->x, r->y, r->w, r->h), r->color, (float)r->rounding);
+    } break;
+    case NK_COMMAND_CIRCLE: {
+        const struct nk_command_circle *c = (const struct nk_command_circle*)cmd;
+        nk_draw_list_stroke_circle(list, nk_vec2((float)c->x + (float)c->w/2, (float)c->y + (float)c->h/2),
+            (float)c->w/2, c->color,
+            nk_sdl_arc_segments(quality, scale, (float)c->w/2, 2.0f * NK_PI, config->circle_segment_count), c->line_thickness);
+    } break;
+    case NK_COMMAND_CIRCLE_FILLED: {
+        const struct nk_command_circle_filled *c = (const struct nk_command_circle_filled*)cmd;
+        nk_draw_list_fill_circle(list, nk_vec2((float)c->x + (float)c->w/2, (float)c->y + (float)c->h/2),
+            (float)c->w/2, c->color,
+            nk_sdl_arc_segments(quality, scale, (float)c->w/2, 2.0f * NK_PI, config->circle_segment_count));
+    } break;
+    case NK_COMMAND_ARC: {
+        const struct nk_command_arc *c = (const struct nk_command_arc*)cmd;
+        nk_draw_list_path_line_to(list, nk_vec2(c->cx, c->cy));
+        nk_draw_list_path_arc_to(list, nk_vec2(c->cx, c->cy), c->r, c->a[0], c->a[1],
+            nk_sdl_arc_segments(quality, scale, c->r, NK_ABS(c->a[1] - c->a[0]), config->arc_segment_count));
+        nk_draw_list_path_stroke(list, c->color, NK_STROKE_CLOSED, c->line_thickness);
+    } break;
+    case NK_COMMAND_ARC_FILLED: {
+        const struct nk_command_arc_filled *c = (const struct nk_command_arc_filled*)cmd;
+        nk_draw_list_path_line_to(list, nk_vec2(c->cx, c->cy));
+        nk_draw_list_path_arc_to(list, nk_vec2(c->cx, c->cy), c->r, c->a[0], c->a[1],
+            nk_sdl_arc_segments(quality, scale, c->r, NK_ABS(c->a[1] - c->a[0]), config->arc_segment_count));
+        nk_draw_list_path_fill(list, c->color);
+    } break;
+    case NK_COMMAND_TRIANGLE: {
+        const struct nk_command_triangle *t = (const struct nk_command_triangle*)cmd;
+        nk_draw_list_stroke_triangle(list, nk_vec2(t->a.x, t->a.y), nk_vec2(t->b.x, t->b.y),
+            nk_vec2(t->c.x, t->c.y), t->color, t->line_thickness);
+    } break;
+    case NK_COMMAND_TRIANGLE_FILLED: {
+        const struct nk_command_triangle_filled *t = (const struct nk_command_triangle_filled*)cmd;
+        nk_draw_list_fill_triangle(list, nk_vec2(t->a.x, t->a.y), nk_vec2(t->b.x, t->b.y),
+            nk_vec2(t->c.x, t->c.y), t->color);
+    } break;
+    case NK_COMMAND_POLYGON: {
+        const struct nk_command_polygon *p = (const struct nk_command_polygon*)cmd;
+        for (i = 0; i < p->point_count; ++i)
+            nk_draw_list_path_line_to(list, nk_vec2((float)p->points[i].x, (float)p->points[i].y));
+        nk_draw_list_path_stroke(list, p->color, NK_STROKE_CLOSED, p->line_thickness);
+    } break;
+    case NK_COMMAND_POLYGON_FILLED: {
+        const struct nk_command_polygon_filled *p = (const struct nk_command_polygon_filled*)cmd;
+        for (i = 0; i < p->point_count; ++i)
+            nk_draw_list_path_line_to(list, nk_vec2((float)p->points[i].x, (float)p->points[i].y));
+        nk_draw_list_path_fill(list, p->color);
+    } break;
+    case NK_COMMAND_POLYLINE: {
+        const struct nk_command_polyline *p = (const struct nk_command_polyline*)cmd;
+        for (i = 0; i < p->point_count; ++i)
+            nk_draw_list_path_line_to(list, nk_vec2((float)p->points[i].x, (float)p->points[i].y));
+        nk_draw_list_path_stroke(list, p->color, NK_STROKE_OPEN, p->line_thickness);
+    } break;
+    case NK_COMMAND_CUSTOM: {
+        const struct nk_command_custom *c = (const struct nk_command_custom*)cmd;
+        c->callback(list, c->x, c->y, c->w, c->h, c->callback_data);
+    } break;
+    default: break;
+    }
+}
+
+/* Replacement for nk_convert that emits quads for the simple primitives. With
+ * quads off only unrounded rects are turned into quads, as the quality
+ * profiles ask for. */
+NK_INTERN void
+nk_sdl_convert_native(struct nk_context *ctx, struct nk_buffer *cmds,
+    struct nk_buffer *vertices, struct nk_buffer *elements, const struct nk_convert_config *config,
+    enum nk_sdl_quality quality, float scale, int quads)
+{
+    struct nk_draw_list *list = &ctx->draw_list;
+    const struct nk_command *cmd;
+
+    nk_draw_list_setup(list, config, cmds, vertices, elements, config->line_AA, config->shape_AA);
+    nk_foreach(cmd, ctx)
+    {
+        switch (cmd->type) {
+        case NK_COMMAND_NOP: break;
+        case NK_COMMAND_SCISSOR: {
+            const struct nk_command_scissor *s = (const struct nk_command_scissor*)cmd;
+            nk_draw_list_add_clip(list, nk_rect(s->x, s->y, s->w, s->h));
+        } break;
+        case NK_COMMAND_RECT_FILLED: {
+            const struct nk_command_rect_filled *r = (const struct nk_command_rect_filled*)cmd;
+            if (r->rounding) {
+                nk_sdl_native_tessellate(list, cmd, config, quality, scale);
+                break;
+            }
+            nk_sdl_native_fill(list, r->x, r->y, r->x + r->w, r->y + r->h, r->color);
+        } break;
+        case NK_COMMAND_RECT: {
+            /* four quads centered on the edges, like the stroked path */
+            const struct nk_command_rect *r = (const struct nk_command_rect*)cmd;
+            float h = r->line_thickness * 0.5f;
+            float ox0 = r->x - h, oy0 = r->y - h, ox1 = r->x + r->w + h, oy1 = r->y + r->h + h;
+            float ix0 = r->x + h, iy0 = r->y + h, ix1 = r->x + r->w - h, iy1 = r->y + r->h - h;
+            if (r->rounding || ix0 >= ix1 || iy0 >= iy1) {
+                nk_sdl_native_tessellate(list, cmd, config, quality, scale);
+                break;
+            }
+            nk_sdl_native_fill(list, ox0, oy0, ox1, iy0, r->color);
+            nk_sdl_native_fill(list, ox0, iy1, ox1, oy1, r->color);
+            nk_sdl_native_fill(list, ox0, iy0, ix0, iy1, r->color);
+            nk_sdl_native_fill(list, ix1, iy0, ox1, iy1, r->color);
+        } break;
+        case NK_COMMAND_LINE: {
+            const struct nk_command_line *l = (const struct nk_command_line*)cmd;
+            float h = l->line_thickness * 0.5f;
+            if (!quads) {
+                nk_sdl_native_tessellate(list, cmd, config, quality, scale);
+            } else if (l->begin.y == l->end.y) {
+                nk_sdl_native_fill(list, NK_MIN(l->begin.x, l->end.x), l->begin.y - h,
+                    NK_MAX(l->begin.x, l->end.x), l->begin.y + h, l->color);
+            } else if (l->begin.x == l->end.x) {
+                nk_sdl_native_fill(list, l->begin.x - h, NK_MIN(l->begin.y, l->end.y),
+                    l->begin.x + h, NK_MAX(l->begin.y, l->end.y), l->color);
+            } else nk_sdl_native_tessellate(list, cmd, config, quality, scale);
+        } break;
+        case NK_COMMAND_RECT_MULTI_COLOR: {
+            /* nuklear draws gradients without a fringe already */
+            const struct nk_command_rect_multi_color *r = (const struct nk_command_rect_multi_color*)cmd;
+            nk_draw_list_fill_rect_multi_color(list, nk_rect(r->x, r->y, r->w, r->h),
+                r->left, r->top, r->right, r->bottom);
+        } break;
+        case NK_COMMAND_TEXT: {
+            const struct nk_command_text *t = (const struct nk_command_text*)cmd;
+            if (quads) nk_sdl_native_text(list, t);
+            else nk_draw_list_add_text(list, t->font, nk_rect(t->x, t->y, t->w, t->h),
+                t->string, t->length, t->height, t->foreground);
+        } break;
+        case NK_COMMAND_IMAGE: {
+            const struct nk_command_image *i = (const struct nk_command_image*)cmd;
+            nk_draw_list_add_image(list, i->img, nk_rect(i->x, i->y, i->w, i->h), i->col);
+        } break;
+        default:
+            nk_sdl_native_tessellate(list, cmd, config, quality, scale);
+            break;
+        }
+    }
+}
+
+NK_INTERN void
+nk_sdl_convert_context(struct nk_context *ctx, struct nk_buffer *cmds,
+    struct nk_buffer *vertices, struct nk_buffer *elements, enum nk_anti_aliasing AA,
+    enum nk_sdl_quality quality, float scale, int native)
+{
+    struct nk_sdl_device *dev = &sdl.ogl;
+
+    /* fill converting configuration */
+    struct nk_convert_config config;
+    static const struct nk_draw_vertex_layout_element vertex_layout[] = {
+        {NK_VERTEX_POSITION, NK_FORMAT_FLOAT, NK_OFFSETOF(struct nk_sdl_vertex, position)},
+        {NK_VERTEX_TEXCOORD, NK_FORMAT_FLOAT, NK_OFFSETOF(struct nk_sdl_vertex, uv)},
+        {NK_VERTEX_COLOR, NK_FORMAT_R8G8B8A8, NK_OFFSETOF(struct nk_sdl_vertex, col)},
+        {NK_VERTEX_LAYOUT_END}
+    };
+    NK_MEMSET(&config, 0, sizeof(config));
+    config.vertex_layout = vertex_layout;
+    config.vertex_size = sizeof(struct nk_sdl_vertex);
+    config.vertex_alignment = NK_ALIGNOF(struct nk_sdl_vertex);
+    config.tex_null = dev->tex_null;
+    config.circle_segment_count = 22;
+    config.curve_segment_count = 22;
+    config.arc_segment_count = 22;
+    config.global_alpha = 1.0f;
+    if (quality == NK_SDL_QUALITY_FAST) AA = NK_ANTI_ALIASING_OFF;
+    config.shape_AA = AA;
+    config.line_AA = AA;
+
+    /* convert shapes into vertexes, reusing last frame's storage */
+    nk_buffer_clear(cmds);
+    nk_buffer_clear(vertices);
+    nk_buffer_clear(elements);
+    if (native || quality != NK_SDL_QUALITY_FIXED)
+        nk_sdl_convert_native(ctx, cmds, vertices, elements, &config, quality, scale, native);
+    else nk_convert(ctx, cmds, vertices, elements, &config);
+}
+
+NK_INTERN void
+nk_sdl_convert(enum nk_anti_aliasing AA)
+{
+    struct nk_sdl_device *dev = &sdl.ogl;
+    nk_sdl_convert_context(&sdl.ctx, &dev->cmds, &dev->vbuf.buf, &dev->ebuf.buf, AA, dev->quality.active, dev->quality.scale, dev->native);
+}
+
+NK_INTERN int
+nk_sdl_window_visible(const struct nk_window *win)
+{
+    return !(win->buffer.last == win->buffer.begin || (win->flags & NK_WINDOW_HIDDEN) ||
+        win->seq != sdl.ctx.seq);
+}
+
+/* Cache key of a window: name, theme version, bounds, scroll offsets and the
+ * contents of its command buffer. */
+NK_INTERN Uint64
+nk_sdl_window_key(const struct nk_window *win)
+{
+    const nk_byte *buffer = (const nk_byte*)sdl.ctx.memory.memory.ptr;
+    nk_size offset = win->buffer.begin;
+    Uint64 key = 0xcbf29ce484222325ull;
+
+    key = nk_sdl_hash(key, &win->name, sizeof(win->name));
+    key = nk_sdl_hash(key, &sdl.ogl.wcache.theme_version, sizeof(sdl.ogl.wcache.theme_version));
+    key = nk_sdl_hash(key, &win->bounds, sizeof(win->bounds));
+    key = nk_sdl_hash(key, &win->scrollbar, sizeof(win->scrollbar));
+    for (;;) {
+        const struct nk_command *cmd = (const struct nk_command*)(buffer + offset);
+        nk_size len = nk_sdl_command_size(cmd);
+        key = nk_sdl_hash(key, &cmd->type, sizeof(cmd->type));
+        if (len > sizeof(struct nk_command))
+            key = nk_sdl_hash(key, cmd + 1, len - sizeof(struct nk_command));
+        if (offset == win->buffer.last) break;
+        offset = cmd->next;
+    }
+    return key;
+}
+
+NK_INTERN struct nk_sdl_cached_window*
+nk_sdl_window_cache_entry(nk_hash name)
+{
+    struct nk_sdl_window_cache *cache = &sdl.ogl.wcache;
+    struct nk_sdl_cached_window *oldest = &cache->entries[0];
+    int i;
+
+    for (i = 0; i < NK_SDL_WINDOW_CACHE_SIZE; ++i) {
+        struct nk_sdl_cached_window *e = &cache->entries[i];
+        if (e->used && e->name == name) return e;
+        if (!e->used || (oldest->used && e->last_frame < oldest->last_frame)) oldest = e;
+    }
+    if (oldest->texture) SDL_DestroyTexture(oldest->texture);
+    NK_MEMSET(oldest, 0, sizeof(*oldest));
+    oldest->used = 1;
+    oldest->name = name;
+    return oldest;
+}
+
+/* Converts and draws a single window into its cache texture. Runs before the
+ * frame's command list is built, so the other windows can be hidden from
+ * nk_convert for the duration. */
+NK_INTERN int
+nk_sdl_window_cache_fill(struct nk_sdl_cached_window *e, struct nk_window *win)
+{
+    struct nk_sdl_device *dev = &sdl.ogl;
+    struct nk_window *it;
+    struct nk_sdl_vertex *v;
+    struct nk_sdl_batch *batch;
+    SDL_Rect viewport;
+    Uint8 r, g, b, a;
+    float scale_x, scale_y;
+    int w, h;
+    unsigned int i;
+    nk_size n;
+
+    SDL_RenderGetScale(sdl.renderer, &scale_x, &scale_y);
+    e->area = nk_rect(win->bounds.x - 2, win->bounds.y - 2, win->bounds.w + 4, win->bounds.h + 4);
+    w = (int)SDL_ceilf(e->area.w * scale_x);
+    h = (int)SDL_ceilf(e->area.h * scale_y);
+    if (w <= 0 || h <= 0) return 0;
+    if (!e->texture || e->tex_w != w || e->tex_h != h) {
+        if (e->texture) SDL_DestroyTexture(e->texture);
+        e->texture = SDL_CreateTexture(sdl.renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, w, h);
+        if (!e->texture) return 0;
+        if (SDL_SetTextureBlendMode(e->texture, dev->wcache.blend) != 0) {
+            SDL_Log("premultiplied blending unsupported, window cache disabled");
+            dev->wcache.enabled = 0;
+            return 0;
+        }
+        e->tex_w = w;
+        e->tex_h = h;
+    }
+
+    /* isolate the window: hide everything else and park active popups, which
+     * nk_build would otherwise consume */
+    for (it = sdl.ctx.begin; it; it = it->next) {
+        if (it != win && !(it->flags & NK_WINDOW_HIDDEN)) {
+            it->flags |= NK_WINDOW_HIDDEN | NK_SDL_WINDOW_ISOLATED;
+        }
+        if (it->popup.buf.active) {
+            it->popup.buf.active = nk_false;
+            it->flags |= NK_SDL_WINDOW_POPUP_PARKED;
+        }
+    }
+    sdl.ctx.build = nk_false;
+    nk_sdl_convert(dev->aa);
+    for (it = sdl.ctx.begin; it; it = it->next) {
+        if (it->flags & NK_SDL_WINDOW_ISOLATED)
+            it->flags &= ~(nk_flags)(NK_WINDOW_HIDDEN | NK_SDL_WINDOW_ISOLATED);
+        if (it->flags & NK_SDL_WINDOW_POPUP_PARKED) {
+            it->popup.buf.active = nk_true;
+            it->flags &= ~(nk_flags)NK_SDL_WINDOW_POPUP_PARKED;
+        }
+    }
+    sdl.ctx.build = nk_false;
+
+    /* move the geometry into texture space */
+    v = (struct nk_sdl_vertex*)nk_buffer_memory(&dev->vbuf.buf);
+    n = dev->vbuf.buf.needed / sizeof(*v);
+    while (n--) {
+        v->position[0] -= e->area.x;
+        v->position[1] -= e->area.y;
+        v++;
+    }
+    nk_sdl_build_batches(&sdl.ctx, &dev->cmds, (nk_draw_index*)nk_buffer_memory(&dev->ebuf.buf));
+    batch = (struct nk_sdl_batch*)nk_buffer_memory(&dev->batches);
+    for (i = 0; i < dev->batch_count; ++i) {
+        batch[i].clip.x -= e->area.x;
+        batch[i].clip.y -= e->area.y;
+    }
+
+    SDL_SetRenderTarget(sdl.renderer, e->texture);
+    SDL_RenderSetScale(sdl.renderer, scale_x, scale_y);
+    SDL_GetRenderDrawColor(sdl.renderer, &r, &g, &b, &a);
+    SDL_SetRenderDrawColor(sdl.renderer, 0, 0, 0, 0);
+    SDL_RenderClear(sdl.renderer);
+    SDL_SetRenderDrawColor(sdl.renderer, r, g, b, a);
+    SDL_RenderGetViewport(sdl.renderer, &viewport);
+    NK_MEMSET(&dev->state, 0, sizeof(dev->state));
+    nk_sdl_draw_batches(nk_buffer_memory_const(&dev->vbuf.buf), NULL, &viewport);
+    SDL_SetRenderTarget(sdl.renderer, NULL);
+    NK_MEMSET(&dev->state, 0, sizeof(dev->state));
+
+    dev->wcache.stats.fills++;
+    return 1;
+}
+
+/* Decides, before the command list is built, which windows are drawn from
+ * their cache texture this frame and hides them from nk_convert. A window
+ * qualifies when it is visible, inactive, not hovered, has no open popup, has
+ * been unchanged for a few frames, and no window drawn from geometry lies
+ * below it and overlaps it (cached windows are blitted first). */
+NK_INTERN void
+nk_sdl_window_cache_begin(void)
+{
+    struct nk_sdl_device *dev = &sdl.ogl;
+    struct nk_sdl_window_cache *cache = &dev->wcache;
+    struct nk_context *ctx = &sdl.ctx;
+    struct nk_window *win, *below;
+    unsigned long frame = dev->frames.rendered + dev->frames.skipped;
+
+    cache->count = 0;
+    cache->stats.hits = 0;
+    cache->stats.fills = 0;
+    if (!cache->enabled || dev->pipe.enabled) return;
+    if (!cache->blend) {
+        cache->blend = SDL_ComposeCustomBlendMode(
+            SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+            SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+    }
+    if (!SDL_RenderTargetSupported(sdl.renderer)) {
+        cache->enabled = 0;
+        return;
+    }
+
+    for (win = ctx->begin; win; win = win->next) {
+        struct nk_sdl_cached_window *e;
+        Uint64 key;
+        int eligible;
+
+        if (!nk_sdl_window_visible(win)) continue;
+        eligible = win != ctx->active && !win->popup.win && !win->popup.buf.active &&
+            !nk_input_is_mouse_hovering_rect(&ctx->input, win->bounds) &&
+            cache->count < NK_SDL_WINDOW_CACHE_SIZE;
+        for (below = ctx->begin; eligible && below != win; below = below->next) {
+            struct nk_rect o;
+            if (!nk_sdl_window_visible(below) || (below->flags & NK_SDL_WINDOW_CACHED)) continue;
+            o = nk_sdl_rect_intersect(below->bounds, win->bounds);
+            if (o.w > 0 && o.h > 0) eligible = 0;
+        }
+
+        e = nk_sdl_window_cache_entry(win->name);
+        e->last_frame = frame;
+        key = nk_sdl_window_key(win);
+        if (key != e->key) {
+            e->key = key;
+            e->stable = 0;
+            e->valid = 0;
+        } else if (e->stable < NK_SDL_WINDOW_CACHE_DELAY) {
+            e->stable++;
+        }
+        if (!eligible) continue;
+        if (!e->valid) {
+            int filled;
+            if (e->stable < NK_SDL_WINDOW_CACHE_DELAY) continue;
+            NK_SDL_TRACE_BEGIN("window cache fill");
+            filled = nk_sdl_window_cache_fill(e, win);
+            NK_SDL_TRACE_END();
+            if (!filled) continue;
+            e->valid = 1;
+        } else cache->stats.hits++;
+
+        win->flags |= NK_WINDOW_HIDDEN | NK_SDL_WINDOW_CACHED;
+        cache->order[cache->count++] = e;
+    }
+    cache->stats.cached = (unsigned int)cache->count;
+}
+
+/* Undoes the hiding done by nk_sdl_window_cache_begin. */
+NK_INTERN void
+nk_sdl_window_cache_end(void)
+{
+    struct nk_window *win;
+    if (!sdl.ogl.wcache.count) return;
+    for (win = sdl.ctx.begin; win; win = win->next) {
+        if (win->flags & NK_SDL_WINDOW_CACHED)
+            win->flags &= ~(nk_flags)(NK_WINDOW_HIDDEN | NK_SDL_WINDOW_CACHED);
+    }
+    sdl.ogl.wcache.count = 0;
+}
+
+/* Blits cached windows bottom to top, restricted to region if one is given. */
+NK_INTERN void
+nk_sdl_draw_cached_windows(const struct nk_rect *region, const SDL_Rect *viewport)
+{
+    struct nk_sdl_window_cache *cache = &sdl.ogl.wcache;
+    int i;
+
+    for (i = 0; i < cache->count; ++i) {
+        const struct nk_sdl_cached_window *e = cache->order[i];
+        struct nk_rect clip = e->area;
+        SDL_FRect dst;
+
+        if (region) {
+            clip = nk_sdl_rect_intersect(clip, *region);
+            if (clip.w <= 0 || clip.h <= 0) continue;
+        }
+        nk_sdl_set_clip(&clip, viewport);
+        dst.x = e->area.x; dst.y = e->area.y;
+        dst.w = e->area.w; dst.h = e->area.h;
+        SDL_RenderCopyF(sdl.renderer, e->texture, NULL, &dst);
+    }
+}
+
+/* Per-frame setup that has to happen before nuklear links the command list. */
+NK_INTERN void
+nk_sdl_frame_begin(void)
+{
+    struct nk_sdl_device *dev = &sdl.ogl;
+    if (dev->frame_begun) return;
+    dev->frame_begun = 1;
+    nk_sdl_window_cache_begin();
+}
+
+NK_INTERN void
+nk_sdl_frame_end(void)
+{
+    struct nk_sdl_device *dev = &sdl.ogl;
+    nk_sdl_window_cache_end();
+    dev->frame_begun = 0;
+    nk_clear(&sdl.ctx);
+    nk_buffer_clear(&dev->cmds);
+}
+
+NK_API void
+nk_sdl_set_window_cache(int enable)
+{
+    struct nk_sdl_window_cache *cache = &sdl.ogl.wcache;
+    int i;
+    cache->enabled = enable;
+    if (enable) return;
+    for (i = 0; i < NK_SDL_WINDOW_CACHE_SIZE; ++i) {
+        if (cache->entries[i].texture) SDL_DestroyTexture(cache->entries[i].texture);
+        NK_MEMSET(&cache->entries[i], 0, sizeof(cache->entries[i]));
+    }
+}
+
+/* Forces everything on screen and in the window cache to be converted again,
+ * after a change to how the geometry is produced. */
+NK_INTERN void
+nk_sdl_invalidate_geometry(void)
+{
+    int i;
+    for (i = 0; i < NK_SDL_WINDOW_CACHE_SIZE; ++i)
+        sdl.ogl.wcache.entries[i].valid = 0;
+    nk_sdl_invalidate();
+}
+
+NK_API void
+nk_sdl_set_native_commands(int enable)
+{
+    struct nk_sdl_device *dev = &sdl.ogl;
+    if (!enable == !dev->native) return;
+    dev->native = enable;
+    nk_sdl_invalidate_geometry();
+}
+
+NK_INTERN void
+nk_sdl_quality_activate(enum nk_sdl_quality active)
+{
+    struct nk_sdl_quality_state *q = &sdl.ogl.quality;
+    q->over = q->under = 0;
+    if (q->active == active) return;
+    q->active = active;
+    nk_sdl_invalidate_geometry();
+}
+
+NK_API void
+nk_sdl_set_quality(enum nk_sdl_quality profile)
+{
+    if ((unsigned int)profile >= NK_SDL_QUALITY_COUNT) return;
+    sdl.ogl.quality.profile = profile;
+    nk_sdl_quality_activate(profile);
+}
+
+NK_API void
+nk_sdl_set_dpi_scale(float scale)
+{
+    struct nk_sdl_quality_state *q = &sdl.ogl.quality;
+    if (scale <= 0 || scale == q->scale) return;
+    q->scale = scale;
+    if (q->active != NK_SDL_QUALITY_FIXED)
+        nk_sdl_invalidate_geometry();
+}
+
+NK_API void
+nk_sdl_set_frame_budget(float ms)
+{
+    sdl.ogl.quality.budget_ms = ms;
+    if (ms <= 0) nk_sdl_quality_activate(sdl.ogl.quality.profile);
+}
+
+/* Feeds the time the last frame took to build and render. Sustained frames
+ * over budget switch to FAST, sustained frames well under it switch back. */
+NK_API void
+nk_sdl_report_frame_time(float ms)
+{
+    struct nk_sdl_quality_state *q = &sdl.ogl.quality;
+    if (q->budget_ms <= 0 || q->profile == NK_SDL_QUALITY_FAST) return;
+
+    if (q->active != NK_SDL_QUALITY_FAST) {
+        q->over = ms > q->budget_ms ? q->over + 1 : 0;
+        if (q->over >= NK_SDL_QUALITY_OVER_FRAMES) {
+            SDL_Log("quality: frames over the %.1f ms budget, switching from %s to fast",
+                q->budget_ms, nk_sdl_quality_name(q->active));
+            nk_sdl_quality_activate(NK_SDL_QUALITY_FAST);
+        }
+    } else {
+        q->under = ms < q->budget_ms * 0.5f ? q->under + 1 : 0;
+        if (q->under >= NK_SDL_QUALITY_RECOVER_FRAMES) {
+            SDL_Log("quality: back under budget, switching to %s", nk_sdl_quality_name(q->profile));
+            nk_sdl_quality_activate(q->profile);
+        }
+    }
+}
+
+NK_API void
+nk_sdl_quality_stats(struct nk_sdl_quality_stats *stats)
+{
+    const struct nk_sdl_quality_state *q = &sdl.ogl.quality;
+    int i;
+    stats->profile = q->profile;
+    stats->active = q->active;
+    for (i = 0; i < NK_SDL_QUALITY_COUNT; ++i)
+        stats->vertices[i] = q->vertices[i];
+}
+
+NK_API const char*
+nk_sdl_quality_name(enum nk_sdl_quality profile)
+{
+    static const char *names[NK_SDL_QUALITY_COUNT] = {"fixed", "high", "balanced", "fast"};
+    if ((unsigned int)profile >= NK_SDL_QUALITY_COUNT) return "unknown";
+    return names[profile];
+}
+
+NK_API void
+nk_sdl_set_theme_version(unsigned int version)
+{
+    sdl.ogl.wcache.theme_version = version;
+}
+
+NK_API void
+nk_sdl_window_cache_stats(struct nk_sdl_window_cache_stats *stats)
+{
+    *stats = sdl.ogl.wcache.stats;
+}
+
+/* Redraws only the damaged parts of the persistent target, then copies it to
+ * the screen. Returns 0 if partial redraw is not possible this frame. */
+NK_INTERN int
+nk_sdl_render_damaged(const void *vertices)
+{
+    struct nk_sdl_device *dev = &sdl.ogl;
+    struct nk_sdl_damage *damage = &dev->damage;
+    SDL_Rect viewport;
+    SDL_BlendMode blend;
+    float scale_x, scale_y;
+    int i;
+
+    if (!damage->enabled || !nk_sdl_damage_target(damage))
+        return 0;
+
+    SDL_RenderGetViewport(sdl.renderer, &viewport);
+    SDL_RenderGetScale(sdl.renderer, &scale_x, &scale_y);
+    damage->screen = nk_rect(0, 0, (float)viewport.w, (float)viewport.h);
+    NK_SDL_TRACE_BEGIN("damage");
+    nk_sdl_damage_compute(damage);
+    NK_SDL_TRACE_END();
+
+    /* SDL keeps viewport, clip and scale per target, the screen's are restored
+     * when switching back */
+    SDL_SetRenderTarget(sdl.renderer, damage->target);
+    SDL_RenderSetScale(sdl.renderer, scale_x, scale_y);
+    SDL_RenderGetViewport(sdl.renderer, &viewport);
+    SDL_GetRenderDrawBlendMode(sdl.renderer, &blend);
+    NK_MEMSET(&dev->state, 0, sizeof(dev->state));
+
+    for (i = 0; i < damage->rect_count; ++i) {
+        SDL_FRect f;
+        f.x = damage->rects[i].x; f.y = damage->rects[i].y;
+        f.w = damage->rects[i].w; f.h = damage->rects[i].h;
+        nk_sdl_set_clip(&damage->rects[i], &viewport);
+        SDL_SetRenderDrawBlendMode(sdl.renderer, SDL_BLENDMODE_NONE);
+        SDL_RenderFillRectF(sdl.renderer, &f);
+        SDL_SetRenderDrawBlendMode(sdl.renderer, blend);
+        nk_sdl_draw_cached_windows(&damage->rects[i], &viewport);
+        nk_sdl_draw_batches(vertices, &damage->rects[i], &viewport);
+    }
+
+    SDL_SetRenderTarget(sdl.renderer, NULL);
+    NK_MEMSET(&dev->state, 0, sizeof(dev->state));
+    SDL_RenderCopy(sdl.renderer, damage->target, NULL, NULL);
+    if (damage->overlay)
+        nk_sdl_damage_overlay(damage);
+    return 1;
+}
+
+NK_API void
+nk_sdl_set_partial_redraw(int enable)
+{
+    struct nk_sdl_damage *damage = &sdl.ogl.damage;
+    if (enable && !damage->enabled) damage->full = 1;
+    damage->enabled = enable;
+}
+
+NK_API void
+nk_sdl_set_damage_overlay(int enable)
+{
+    sdl.ogl.damage.overlay = enable;
+}
+
+NK_API void
+nk_sdl_damage_stats(struct nk_sdl_damage_stats *stats)
+{
+    *stats = sdl.ogl.damage.stats;
+}
+
+/* Draws cached windows and batches straight to the current target, then
+ * restores the caller's clip state. */
+NK_INTERN void
+nk_sdl_draw_screen(const void *vertices)
+{
+    struct nk_sdl_device *dev = &sdl.ogl;
+    SDL_Rect saved_clip;
+    SDL_Rect viewport;
+    SDL_bool clipping_enabled;
+
+    clipping_enabled = SDL_RenderIsClipEnabled(sdl.renderer);
+    SDL_RenderGetClipRect(sdl.renderer, &saved_clip);
+    SDL_RenderGetViewport(sdl.renderer, &viewport);
+    NK_MEMSET(&dev->state, 0, sizeof(dev->state));
+
+    nk_sdl_draw_cached_windows(NULL, &viewport);
+    nk_sdl_draw_batches(vertices, NULL, &viewport);
+
+    /* restore the caller's clip state, unless nothing was changed */
+    if (dev->state.clip_valid) {
+        if (!clipping_enabled) {
+            SDL_RenderSetClipRect(sdl.renderer, NULL);
+        } else if (saved_clip.x != dev->state.sdl_clip.x || saved_clip.y != dev->state.sdl_clip.y ||
+            saved_clip.w != dev->state.sdl_clip.w || saved_clip.h != dev->state.sdl_clip.h) {
+            SDL_RenderSetClipRect(sdl.renderer, &saved_clip);
+        } else dev->render.state_changes_avoided++;
+    }
+}
+
+NK_INTERN float
+nk_sdl_elapsed_ms(Uint64 from, Uint64 to)
+{
+    return (float)((double)(to - from) * 1000.0 / (double)SDL_GetPerformanceFrequency());
+}
+
+/* Copies the linked command list of the UI context into the slot's shadow
+ * context, rewriting the links so the copy is one contiguous window. */
+NK_INTERN void
+nk_sdl_pipeline_snapshot(struct nk_sdl_pipeline_slot *slot)
+{
+    struct nk_buffer *mem = &slot->ctx.memory;
+    const struct nk_command *cmd;
+    struct nk_command *copy;
+    nk_size last = 0;
+    int count = 0;
+
+    nk_buffer_clear(mem);
+    nk_foreach(cmd, &sdl.ctx) {
+        nk_size len = nk_sdl_command_size(cmd);
+        copy = (struct nk_command*)nk_buffer_alloc(mem, NK_BUFFER_FRONT, len, NK_ALIGNOF(struct nk_command));
+        if (!copy) break;
+        NK_MEMCPY(copy, cmd, len);
+        if (count)
+            nk_ptr_add(struct nk_command, mem->memory.ptr, last)->next = (nk_size)((nk_byte*)copy - (nk_byte*)mem->memory.ptr);
+        last = (nk_size)((nk_byte*)copy - (nk_byte*)mem->memory.ptr);
+        count++;
+    }
+    if (count)
+        nk_ptr_add(struct nk_command, mem->memory.ptr, last)->next = mem->allocated;
+
+    slot->win.buffer.begin = 0;
+    slot->win.buffer.last = last;
+    slot->win.buffer.end = mem->allocated;
+    slot->ctx.begin = slot->ctx.end = &slot->win;
+    slot->ctx.count = count ? 1 : 0;
+    slot->ctx.build = nk_true;
+}
+
+NK_INTERN int SDLCALL
+nk_sdl_pipeline_worker(void *data)
+{
+    struct nk_sdl_pipeline *pipe = (struct nk_sdl_pipeline*)data;
+    NK_SDL_TRACE_THREAD("nk_sdl pipeline");
+    for (;;) {
+        struct nk_sdl_pipeline_slot *slot;
+        Uint64 start;
+
+        SDL_SemWait(pipe->work);
+        if (pipe->quit) break;
+        slot = pipe->job;
+        start = SDL_GetPerformanceCounter();
+        NK_SDL_TRACE_BEGIN("convert");
+        nk_sdl_convert_context(&slot->ctx, &slot->cmds, &slot->vbuf.buf, &slot->ebuf.buf, slot->aa, slot->quality, slot->scale, slot->native);
+        NK_SDL_TRACE_END();
+        slot->convert_ms = nk_sdl_elapsed_ms(start, SDL_GetPerformanceCounter());
+        SDL_SemPost(pipe->done);
+    }
+    return 0;
+}
+
+/* Waits until the worker is idle, e.g. before state it reads changes. With
+ * drop, the frame it converted is discarded and the next one is forced out. */
+NK_INTERN void
+nk_sdl_pipeline_sync(int drop)
+{
+    struct nk_sdl_pipeline *pipe = &sdl.ogl.pipe;
+
+    if (!pipe->enabled || !pipe->pending) return;
+    SDL_SemWait(pipe->done);
+    if (drop) {
+        pipe->pending = NULL;
+        nk_sdl_invalidate();
+    } else SDL_SemPost(pipe->done);
+}
 
-#include <string>
+/* Waits for the frame converted since the last call, queues this frame on the
+ * worker and submits the finished one while the worker runs. With nothing in
+ * flight, on the first frame or after a drop, it waits for this one instead. */
+NK_INTERN void
+nk_sdl_render_pipelined(enum nk_anti_aliasing AA)
+{
+    struct nk_sdl_device *dev = &sdl.ogl;
+    struct nk_sdl_pipeline *pipe = &dev->pipe;
+    struct nk_sdl_pipeline_slot *ready = pipe->pending;
+    struct nk_sdl_pipeline_stats *last = &pipe->last;
+    Uint64 t0, t1, t2, t3;
 
-struct nk_sdl_device {
-    struct nk_buffer cmds;
-    struct nk_draw_null_texture tex_null;
-    SDL_Texture *font_tex;
-};
+    t0 = SDL_GetPerformanceCounter();
+    last->build_ms = pipe->render_end ? nk_sdl_elapsed_ms(pipe->render_end, t0) : 0;
+    NK_SDL_TRACE_BEGIN("pipeline wait");
+    if (ready) SDL_SemWait(pipe->done);
+    NK_SDL_TRACE_END();
+    if (ready) nk_sdl_memory_sample(&ready->cmds, &ready->vbuf.buf, &ready->ebuf.buf);
+    pipe->pending = NULL;
+    t1 = SDL_GetPerformanceCounter();
+    last->wait_ms = nk_sdl_elapsed_ms(t0, t1);
 
-struct nk_sdl_vertex {
-    float position[2];
-    float uv[2];
-    nk_byte col[4];
-};
+    nk_sdl_frame_begin();
+    dev->aa = AA;
+    if (!pipe->drain) {
+        struct nk_sdl_pipeline_slot *slot = ready == &pipe->slots[0] ? &pipe->slots[1] : &pipe->slots[0];
+        NK_SDL_TRACE_BEGIN("snapshot");
+        nk_sdl_pipeline_snapshot(slot);
+        NK_SDL_TRACE_END();
+        slot->aa = AA;
+        slot->quality = dev->quality.active;
+        slot->scale = dev->quality.scale;
+        slot->native = dev->native;
+        slot->vbuf_size = slot->vbuf.buf.memory.size;
+        slot->ebuf_size = slot->ebuf.buf.memory.size;
+        pipe->job = pipe->pending = slot;
+        SDL_SemPost(pipe->work);
+        if (!ready) {
+            SDL_SemWait(pipe->done);
+            nk_sdl_memory_sample(&slot->cmds, &slot->vbuf.buf, &slot->ebuf.buf);
+            ready = slot;
+            pipe->pending = NULL;
+        }
+    }
+    pipe->drain = 0;
+    t2 = SDL_GetPerformanceCounter();
+    last->snapshot_ms = nk_sdl_elapsed_ms(t1, t2);
 
-static struct nk_sdl {
-    SDL_Window *win;
-    SDL_Renderer *renderer;
-    struct nk_sdl_device ogl;
-    struct nk_context ctx;
-    struct nk_font_atlas atlas;
-} sdl;
+    NK_MEMSET(&dev->render, 0, sizeof(dev->render));
+    dev->render.convert_ms = nk_sdl_elapsed_ms(t0, t2);
+    if (ready) {
+        NK_SDL_TRACE_BEGIN("draw");
+        nk_sdl_build_batches(&ready->ctx, &ready->cmds, (nk_draw_index*)nk_buffer_memory(&ready->ebuf.buf));
+        nk_sdl_draw_screen(nk_buffer_memory_const(&ready->vbuf.buf));
+        NK_SDL_TRACE_END();
+        dev->quality.vertices[ready->quality] = (unsigned int)(ready->vbuf.buf.needed / sizeof(struct nk_sdl_vertex));
+        nk_sdl_frame_buffer_update(&ready->vbuf, ready->vbuf_size);
+        nk_sdl_frame_buffer_update(&ready->ebuf, ready->ebuf_size);
+        last->convert_ms = ready->convert_ms;
+    }
+    nk_sdl_frame_end();
+    dev->frames.rendered++;
 
+    t3 = SDL_GetPerformanceCounter();
+    last->submit_ms = nk_sdl_elapsed_ms(t2, t3);
+    dev->render.draw_ms = last->submit_ms;
+    pipe->render_end = t3;
 
+    pipe->total.build_ms += last->build_ms;
+    pipe->total.snapshot_ms += last->snapshot_ms;
+    pipe->total.convert_ms += last->convert_ms;
+    pipe->total.wait_ms += last->wait_ms;
+    pipe->total.submit_ms += last->submit_ms;
+    pipe->frames++;
+}
 
-NK_INTERN void
-nk_sdl_device_upload_atlas(const void *image, int width, int height)
+NK_API void
+nk_sdl_set_pipelined(int enable)
 {
     struct nk_sdl_device *dev = &sdl.ogl;
+    struct nk_sdl_pipeline *pipe = &dev->pipe;
+    int i;
 
-    SDL_Texture *g_SDLFontTexture = SDL_CreateTexture(sdl.renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, width, height);
-    if (g_SDLFontTexture == NULL) {
-        SDL_Log("error creating texture");
+    if (!enable == !pipe->enabled) return;
+    if (enable) {
+        for (i = 0; i < 2; ++i) {
+            struct nk_sdl_pipeline_slot *slot = &pipe->slots[i];
+            NK_MEMSET(slot, 0, sizeof(*slot));
+            nk_buffer_init(&slot->ctx.memory, &dev->memory.alloc[NK_SDL_MEMORY_CONTEXT], NK_BUFFER_DEFAULT_INITIAL_SIZE);
+            nk_buffer_init(&slot->cmds, &dev->memory.alloc[NK_SDL_MEMORY_COMMANDS], NK_BUFFER_DEFAULT_INITIAL_SIZE);
+            nk_sdl_frame_buffer_init(&slot->vbuf, NK_SDL_MEMORY_VERTICES, NK_SDL_VERTEX_BUFFER_SIZE);
+            nk_sdl_frame_buffer_init(&slot->ebuf, NK_SDL_MEMORY_ELEMENTS, NK_SDL_ELEMENT_BUFFER_SIZE);
+        }
+        pipe->quit = 0;
+        pipe->drain = 0;
+        pipe->job = pipe->pending = NULL;
+        pipe->render_end = 0;
+        pipe->work = SDL_CreateSemaphore(0);
+        pipe->done = SDL_CreateSemaphore(0);
+        pipe->thread = pipe->work && pipe->done ?
+            SDL_CreateThread(nk_sdl_pipeline_worker, "nk_sdl_convert", pipe) : NULL;
+        if (!pipe->thread) {
+            SDL_Log("error creating convert thread, pipelined rendering disabled: %s", SDL_GetError());
+            pipe->enabled = 1;
+            nk_sdl_set_pipelined(0);
+            return;
+        }
+        pipe->enabled = 1;
         return;
     }
-    SDL_UpdateTexture(g_SDLFontTexture, NULL, image, 4 * width);
-    SDL_SetTextureBlendMode(g_SDLFontTexture, SDL_BLENDMODE_BLEND);
-    dev->font_tex = g_SDLFontTexture;
+
+    /* the frame still in flight is dropped, so the next one is forced out */
+    if (pipe->pending) SDL_SemWait(pipe->done);
+    pipe->pending = NULL;
+    if (pipe->thread) {
+        pipe->quit = 1;
+        SDL_SemPost(pipe->work);
+        SDL_WaitThread(pipe->thread, NULL);
+        pipe->thread = NULL;
+    }
+    if (pipe->work) SDL_DestroySemaphore(pipe->work);
+    if (pipe->done) SDL_DestroySemaphore(pipe->done);
+    pipe->work = pipe->done = NULL;
+    for (i = 0; i < 2; ++i) {
+        nk_buffer_free(&pipe->slots[i].ctx.memory);
+        nk_buffer_free(&pipe->slots[i].cmds);
+        nk_buffer_free(&pipe->slots[i].vbuf.buf);
+        nk_buffer_free(&pipe->slots[i].ebuf.buf);
+    }
+    pipe->enabled = 0;
+    nk_sdl_invalidate();
+}
+
+NK_API void
+nk_sdl_pipeline_stats(struct nk_sdl_pipeline_stats *last, struct nk_sdl_pipeline_stats *average)
+{
+    const struct nk_sdl_pipeline *pipe = &sdl.ogl.pipe;
+    float n = (float)NK_MAX(pipe->frames, 1ul);
+    if (last) *last = pipe->last;
+    if (!average) return;
+    average->build_ms = pipe->total.build_ms / n;
+    average->snapshot_ms = pipe->total.snapshot_ms / n;
+    average->convert_ms = pipe->total.convert_ms / n;
+    average->wait_ms = pipe->total.wait_ms / n;
+    average->submit_ms = pipe->total.submit_ms / n;
 }
 
 NK_API void
@@ -85,109 +2434,43 @@ nk_sdl_render(enum nk_anti_aliasing AA)
     /* setup global state */
     struct nk_sdl_device *dev = &sdl.ogl;
 
-    {
-        SDL_Rect saved_clip;
-#ifdef NK_SDL_CLAMP_CLIP_RECT
-        SDL_Rect viewport;
-#endif
-        SDL_bool clipping_enabled;
-        int vs = sizeof(struct nk_sdl_vertex);
-        size_t vp = offsetof(struct nk_sdl_vertex, position);
-        size_t vt = offsetof(struct nk_sdl_vertex, uv);
-        size_t vc = offsetof(struct nk_sdl_vertex, col);
+    if (dev->pipe.enabled) {
+        nk_sdl_render_pipelined(AA);
+        return;
+    }
 
+    {
         /* convert from command queue into draw list and draw to screen */
-        const struct nk_draw_command *cmd;
-        const nk_draw_index *offset = NULL;
-        struct nk_buffer vbuf, ebuf;
-
-        /* fill converting configuration */
-        struct nk_convert_config config;
-        static const struct nk_draw_vertex_layout_element vertex_layout[] = {
-            {NK_VERTEX_POSITION, NK_FORMAT_FLOAT, NK_OFFSETOF(struct nk_sdl_vertex, position)},
-            {NK_VERTEX_TEXCOORD, NK_FORMAT_FLOAT, NK_OFFSETOF(struct nk_sdl_vertex, uv)},
-            {NK_VERTEX_COLOR, NK_FORMAT_R8G8B8A8, NK_OFFSETOF(struct nk_sdl_vertex, col)},
-            {NK_VERTEX_LAYOUT_END}
-        };
-        NK_MEMSET(&config, 0, sizeof(config));
-        config.vertex_layout = vertex_layout;
-        config.vertex_size = sizeof(struct nk_sdl_vertex);
-        config.vertex_alignment = NK_ALIGNOF(struct nk_sdl_vertex);
-        config.tex_null = dev->tex_null;
-        config.circle_segment_count = 22;
-        config.curve_segment_count = 22;
-        config.arc_segment_count = 22;
-        config.global_alpha = 1.0f;
-        config.shape_AA = AA;
-        config.line_AA = AA;
-
-        /* convert shapes into vertexes */
-        nk_buffer_init_default(&vbuf);
-        nk_buffer_init_default(&ebuf);
-        nk_convert(&sdl.ctx, &dev->cmds, &vbuf, &ebuf, &config);
-
-        /* iterate over and execute each draw command */
-        offset = (const nk_draw_index*)nk_buffer_memory_const(&ebuf);
-
-        clipping_enabled = SDL_RenderIsClipEnabled(sdl.renderer);
-        SDL_RenderGetClipRect(sdl.renderer, &saved_clip);
-#ifdef NK_SDL_CLAMP_CLIP_RECT
-        SDL_RenderGetViewport(sdl.renderer, &viewport);
-#endif
-
-        nk_draw_foreach(cmd, &sdl.ctx, &dev->cmds)
-        {
-            if (!cmd->elem_count) continue;
-
-            {
-                SDL_Rect r;
-                r.x = cmd->clip_rect.x;
-                r.y = cmd->clip_rect.y;
-                r.w = cmd->clip_rect.w;
-                r.h = cmd->clip_rect.h;
-#ifdef NK_SDL_CLAMP_CLIP_RECT
-                if (r.x < 0) {
-                    r.w += r.x;
-                    r.x = 0;
-                }
-                if (r.y < 0) {
-                    r.h += r.y;
-                    r.y = 0;
-                }
-                if (r.h > viewport.h) {
-                    r.h = viewport.h;
-                }
-                if (r.w > viewport.w) {
-                    r.w = viewport.w;
-                }
-#endif
-                SDL_RenderSetClipRect(sdl.renderer, &r);
-            }
-
-            {
-                const void *vertices = nk_buffer_memory_const(&vbuf);
+        const void *vertices;
+        nk_size vbuf_size = dev->vbuf.buf.memory.size;
+        nk_size ebuf_size = dev->ebuf.buf.memory.size;
+        Uint64 start, converted;
 
-                SDL_RenderGeometryRaw(sdl.renderer,
-                        (SDL_Texture *)cmd->texture.ptr,
-                        (const float*)((const nk_byte*)vertices + vp), vs,
-                        (const SDL_Color*)((const nk_byte*)vertices + vc), vs,
-                        (const float*)((const nk_byte*)vertices + vt), vs,
-                        (vbuf.needed / vs),
-                        (void *) offset, cmd->elem_count, 2);
+        nk_sdl_frame_begin();
+        dev->aa = AA;
+        start = SDL_GetPerformanceCounter();
+        NK_SDL_TRACE_BEGIN("convert");
+        nk_sdl_convert(AA);
+        NK_SDL_TRACE_END();
+        converted = SDL_GetPerformanceCounter();
+        dev->quality.vertices[dev->quality.active] = (unsigned int)(dev->vbuf.buf.needed / sizeof(struct nk_sdl_vertex));
+        nk_sdl_memory_sample(&dev->cmds, &dev->vbuf.buf, &dev->ebuf.buf);
 
-                offset += cmd->elem_count;
-            }
-        }
+        NK_MEMSET(&dev->render, 0, sizeof(dev->render));
+        dev->render.convert_ms = nk_sdl_elapsed_ms(start, converted);
+        vertices = nk_buffer_memory_const(&dev->vbuf.buf);
+        NK_SDL_TRACE_BEGIN("draw");
+        nk_sdl_build_batches(&sdl.ctx, &dev->cmds, (nk_draw_index*)nk_buffer_memory(&dev->ebuf.buf));
 
-        SDL_RenderSetClipRect(sdl.renderer, &saved_clip);
-        if (!clipping_enabled) {
-            SDL_RenderSetClipRect(sdl.renderer, NULL);
-        }
+        if (!nk_sdl_render_damaged(vertices))
+            nk_sdl_draw_screen(vertices);
+        NK_SDL_TRACE_END();
+        dev->render.draw_ms = nk_sdl_elapsed_ms(converted, SDL_GetPerformanceCounter());
 
-        nk_clear(&sdl.ctx);
-        nk_buffer_clear(&dev->cmds);
-        nk_buffer_free(&vbuf);
-        nk_buffer_free(&ebuf);
+        nk_sdl_frame_end();
+        nk_sdl_frame_buffer_update(&dev->vbuf, vbuf_size);
+        nk_sdl_frame_buffer_update(&dev->ebuf, ebuf_size);
+        dev->frames.rendered++;
     }
 }
 
@@ -216,6 +2499,7 @@ nk_sdl_clipboard_copy(nk_handle usr, const char *text, int len)
 NK_API struct nk_context*
 nk_sdl_init(SDL_Window *win, SDL_Renderer *renderer)
 {
+    int i;
 #ifndef NK_SDL_CLAMP_CLIP_RECT
     SDL_RendererInfo info;
     SDL_version runtimeVer;
@@ -237,31 +2521,739 @@ nk_sdl_init(SDL_Window *win, SDL_Renderer *renderer)
 #endif
     sdl.win = win;
     sdl.renderer = renderer;
-    nk_init_default(&sdl.ctx, 0);
+    if (sdl.ogl.memory.arena.size) {
+        sdl.ogl.memory.arena.base = (nk_byte*)malloc(sdl.ogl.memory.arena.size);
+        if (!sdl.ogl.memory.arena.base) {
+            SDL_Log("error allocating the %lu byte arena, using the heap", (unsigned long)sdl.ogl.memory.arena.size);
+            sdl.ogl.memory.arena.size = 0;
+        }
+    }
+    for (i = 0; i < NK_SDL_MEMORY_COUNT; ++i) {
+        sdl.ogl.memory.counters[i].arena = i != NK_SDL_MEMORY_FONT;
+        sdl.ogl.memory.alloc[i].userdata = nk_handle_ptr(&sdl.ogl.memory.counters[i]);
+        sdl.ogl.memory.alloc[i].alloc = nk_sdl_memory_alloc;
+        sdl.ogl.memory.alloc[i].free = nk_sdl_memory_free;
+    }
+    nk_init(&sdl.ctx, &sdl.ogl.memory.alloc[NK_SDL_MEMORY_CONTEXT], 0);
+    /* no page has been allocated yet, so the pool can still be given its own */
+    sdl.ctx.pool.alloc = sdl.ogl.memory.alloc[NK_SDL_MEMORY_POOL];
     sdl.ctx.clip.copy = nk_sdl_clipboard_copy;
     sdl.ctx.clip.paste = nk_sdl_clipboard_paste;
     sdl.ctx.clip.userdata = nk_handle_ptr(0);
-    nk_buffer_init_default(&sdl.ogl.cmds);
+    nk_buffer_init(&sdl.ogl.cmds, &sdl.ogl.memory.alloc[NK_SDL_MEMORY_COMMANDS], NK_BUFFER_DEFAULT_INITIAL_SIZE);
+    sdl.ogl.alloc.userdata.ptr = 0;
+    sdl.ogl.alloc.alloc = nk_malloc;
+    sdl.ogl.alloc.free = nk_mfree;
+    sdl.ogl.shrink_frames = NK_SDL_BUFFER_SHRINK_FRAMES;
+    nk_sdl_frame_buffer_init(&sdl.ogl.vbuf, NK_SDL_MEMORY_VERTICES, NK_SDL_VERTEX_BUFFER_SIZE);
+    nk_sdl_frame_buffer_init(&sdl.ogl.ebuf, NK_SDL_MEMORY_ELEMENTS, NK_SDL_ELEMENT_BUFFER_SIZE);
+    nk_buffer_init(&sdl.ogl.batches, &sdl.ogl.alloc, NK_BUFFER_DEFAULT_INITIAL_SIZE);
+    nk_buffer_init(&sdl.ogl.damage.items[0], &sdl.ogl.alloc, NK_BUFFER_DEFAULT_INITIAL_SIZE);
+    nk_buffer_init(&sdl.ogl.damage.items[1], &sdl.ogl.alloc, NK_BUFFER_DEFAULT_INITIAL_SIZE);
+    sdl.ogl.damage.full = 1;
+    sdl.ogl.aa = NK_ANTI_ALIASING_ON;
+    sdl.ogl.quality.scale = 1.0f;
     return &sdl.ctx;
 }
 
+NK_API int
+nk_sdl_map_file(struct nk_sdl_file_map *map, const char *path)
+{
+    map->data = NULL;
+    map->size = 0;
+#ifdef _WIN32
+    {
+        HANDLE file, mapping;
+        LARGE_INTEGER size;
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) return 0;
+        if (!GetFileSizeEx(file, &size) || !size.QuadPart) {
+            CloseHandle(file);
+            return 0;
+        }
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        CloseHandle(file);
+        if (!mapping) return 0;
+        map->data = (const nk_byte*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        map->size = (nk_size)size.QuadPart;
+    }
+#else
+    {
+        struct stat st;
+        void *data;
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) return 0;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+            close(fd);
+            return 0;
+        }
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) return 0;
+        map->data = (const nk_byte*)data;
+        map->size = (nk_size)st.st_size;
+    }
+#endif
+    return map->data != NULL;
+}
+
+NK_API void
+nk_sdl_unmap_file(struct nk_sdl_file_map *map)
+{
+    if (!map->data) return;
+#ifdef _WIN32
+    UnmapViewOfFile(map->data);
+#else
+    munmap((void*)map->data, map->size);
+#endif
+    map->data = NULL;
+}
+
+NK_INTERN Uint64
+nk_sdl_font_cache_key(const struct nk_font_atlas *atlas)
+{
+    Uint64 hash = 0xcbf29ce484222325ull;
+    const struct nk_font_config *cfg;
+    nk_size sizes[3];
+
+    sizes[0] = sizeof(struct nk_font_glyph);
+    sizes[1] = sizeof(struct nk_sdl_font_cache_header);
+    sizes[2] = NK_SDL_FONT_CACHE_FORMAT;
+    hash = nk_sdl_hash(hash, NK_SDL_FONT_CACHE_NK_VERSION, sizeof(NK_SDL_FONT_CACHE_NK_VERSION));
+    hash = nk_sdl_hash(hash, sizes, sizeof(sizes));
+    for (cfg = atlas->config; cfg; cfg = cfg->next) {
+        const struct nk_font_config *it = cfg;
+        do {
+            const nk_rune *r;
+            hash = nk_sdl_hash(hash, it->ttf_blob, it->ttf_size);
+            hash = nk_sdl_hash(hash, &it->merge_mode, sizeof(it->merge_mode));
+            hash = nk_sdl_hash(hash, &it->pixel_snap, sizeof(it->pixel_snap));
+            hash = nk_sdl_hash(hash, &it->oversample_v, sizeof(it->oversample_v));
+            hash = nk_sdl_hash(hash, &it->oversample_h, sizeof(it->oversample_h));
+            hash = nk_sdl_hash(hash, &it->size, sizeof(it->size));
+            hash = nk_sdl_hash(hash, &it->coord_type, sizeof(it->coord_type));
+            hash = nk_sdl_hash(hash, &it->spacing, sizeof(it->spacing));
+            hash = nk_sdl_hash(hash, &it->fallback_glyph, sizeof(it->fallback_glyph));
+            for (r = it->range ? it->range : nk_font_default_glyph_ranges(); *r; ++r)
+                hash = nk_sdl_hash(hash, r, sizeof(*r));
+            it = it->n;
+        } while (it != cfg);
+    }
+    return hash;
+}
+
+NK_INTERN void
+nk_sdl_font_cache_path(char *path, int len, Uint64 key)
+{
+    SDL_snprintf(path, (size_t)len, "%s/font-%08x%08x.bin", sdl.font_cache.dir,
+        (unsigned int)(key >> 32), (unsigned int)key);
+}
+
+/* Sets up the fonts from a cached atlas as nk_font_atlas_bake() would have.
+ * The RGBA pixels are left in the mapping, at its end, for the upload.
+ * Returns 0 if there is no valid entry. */
+NK_INTERN int
+nk_sdl_font_cache_load(struct nk_font_atlas *atlas, Uint64 key, struct nk_sdl_file_map *mapping)
+{
+    struct nk_sdl_file_map map;
+    const struct nk_sdl_font_cache_header *header;
+    const struct nk_sdl_font_cache_font *entries;
+    struct nk_font *font;
+    char path[600];
+    nk_size pixels, expected;
+    Uint32 i, count = 0;
+
+    for (font = atlas->fonts; font; font = font->next) count++;
+    nk_sdl_font_cache_path(path, (int)sizeof(path), key);
+    if (!count || !nk_sdl_map_file(&map, path)) return 0;
+
+    header = (const struct nk_sdl_font_cache_header*)map.data;
+    if (map.size < sizeof(*header) || header->magic != NK_SDL_FONT_CACHE_MAGIC ||
+        header->format != NK_SDL_FONT_CACHE_FORMAT || header->key != key || header->font_count != count) {
+        nk_sdl_unmap_file(&map);
+        return 0;
+    }
+    pixels = (nk_size)header->width * header->height * 4;
+    expected = sizeof(*header) + count * sizeof(*entries) + header->glyph_count * sizeof(struct nk_font_glyph) + pixels;
+    entries = (const struct nk_sdl_font_cache_font*)(header + 1);
+    for (i = 0; i < count; ++i)
+        if (entries[i].glyph_offset + entries[i].glyph_count > header->glyph_count) expected = 0;
+    if (map.size != expected) {
+        nk_sdl_unmap_file(&map);
+        return 0;
+    }
+
+    atlas->glyph_count = (int)header->glyph_count;
+    atlas->glyphs = (struct nk_font_glyph*)atlas->permanent.alloc(atlas->permanent.userdata, 0,
+        sizeof(struct nk_font_glyph) * header->glyph_count);
+    if (!atlas->glyphs) {
+        nk_sdl_unmap_file(&map);
+        return 0;
+    }
+    NK_MEMCPY(atlas->glyphs, entries + count, sizeof(struct nk_font_glyph) * header->glyph_count);
+    atlas->tex_width = (int)header->width;
+    atlas->tex_height = (int)header->height;
+    atlas->custom = header->custom;
+    NK_MEMCPY(atlas->cursors, header->cursors, sizeof(atlas->cursors));
+
+    for (font = atlas->fonts, i = 0; font; font = font->next, ++i) {
+        struct nk_font_config *config = font->config;
+        struct nk_baked_font *baked = config->font;
+        baked->height = entries[i].height;
+        baked->ascent = entries[i].ascent;
+        baked->descent = entries[i].descent;
+        baked->glyph_offset = entries[i].glyph_offset;
+        baked->glyph_count = entries[i].glyph_count;
+        baked->ranges = config->range ? config->range : nk_font_default_glyph_ranges();
+        nk_font_init(font, config->size, config->fallback_glyph, atlas->glyphs, baked, nk_handle_ptr(0));
+    }
+    *mapping = map;
+    return 1;
+}
+
+/* Writes a freshly baked atlas, through a temporary file so that a crash
+ * never leaves a truncated entry behind. */
+NK_INTERN int
+nk_sdl_font_cache_store(const struct nk_font_atlas *atlas, Uint64 key, const void *image)
+{
+    struct nk_sdl_font_cache_header header;
+    const struct nk_font *font;
+    char path[600], tmp[608];
+    FILE *file;
+    int ok;
+
+    NK_MEMSET(&header, 0, sizeof(header));
+    header.magic = NK_SDL_FONT_CACHE_MAGIC;
+    header.format = NK_SDL_FONT_CACHE_FORMAT;
+    header.key = key;
+    header.width = (Uint32)atlas->tex_width;
+    header.height = (Uint32)atlas->tex_height;
+    header.glyph_count = (Uint32)atlas->glyph_count;
+    header.custom = atlas->custom;
+    NK_MEMCPY(header.cursors, atlas->cursors, sizeof(header.cursors));
+    for (font = atlas->fonts; font; font = font->next) header.font_count++;
+
+    nk_sdl_font_cache_path(path, (int)sizeof(path), key);
+    SDL_snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    file = fopen(tmp, "wb");
+    if (!file) return 0;
+    ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (font = atlas->fonts; font && ok; font = font->next) {
+        struct nk_sdl_font_cache_font entry;
+        entry.height = font->info.height;
+        entry.ascent = font->info.ascent;
+        entry.descent = font->info.descent;
+        entry.glyph_offset = font->info.glyph_offset;
+        entry.glyph_count = font->info.glyph_count;
+        ok = fwrite(&entry, sizeof(entry), 1, file) == 1;
+    }
+    ok = ok && fwrite(atlas->glyphs, sizeof(struct nk_font_glyph), (size_t)atlas->glyph_count, file) == (size_t)atlas->glyph_count;
+    ok = ok && fwrite(image, (size_t)atlas->tex_width * 4, (size_t)atlas->tex_height, file) == (size_t)atlas->tex_height;
+    ok = fclose(file) == 0 && ok;
+#ifdef _WIN32
+    if (ok) remove(path);
+#endif
+    if (!ok || rename(tmp, path) != 0) {
+        remove(tmp);
+        return 0;
+    }
+    return 1;
+}
+
+NK_API void
+nk_sdl_set_font_cache(const char *dir)
+{
+    sdl.font_cache.dir[0] = '\0';
+    if (dir) SDL_strlcpy(sdl.font_cache.dir, dir, sizeof(sdl.font_cache.dir));
+}
+
+NK_API void
+nk_sdl_font_cache_stats(struct nk_sdl_font_cache_stats *stats)
+{
+    *stats = sdl.font_cache.stats;
+}
+
+/* Multiplies every normalized v coordinate of the font texture by factor,
+ * after its height changed. */
+NK_INTERN void
+nk_sdl_glyph_rescale(float factor)
+{
+    struct nk_sdl_glyph_cache *cache = &sdl.glyphs;
+    int i, j;
+
+    for (i = 0; i < sdl.atlas.glyph_count; ++i) {
+        sdl.atlas.glyphs[i].v0 *= factor;
+        sdl.atlas.glyphs[i].v1 *= factor;
+    }
+    for (i = 0; i < cache->font_count; ++i) {
+        struct nk_sdl_lazy_font *lf = &cache->fonts[i];
+        for (j = 0; j < lf->count; ++j) {
+            lf->glyphs[j].glyph.v0 *= factor;
+            lf->glyphs[j].glyph.v1 *= factor;
+        }
+    }
+    sdl.ogl.tex_null.uv.y *= factor;
+    for (i = 0; i < NK_CURSOR_COUNT; ++i)
+        sdl.atlas.cursors[i].img.h = (nk_ushort)cache->height;
+}
+
+/* Doubles the rows for lazy glyphs. The texture is recreated from the copy,
+ * so a frame the pipeline worker converted with the old coordinates is dropped. */
+NK_INTERN int
+nk_sdl_glyph_grow(void)
+{
+    struct nk_sdl_glyph_cache *cache = &sdl.glyphs;
+    struct nk_allocator *alloc = &sdl.ogl.memory.alloc[NK_SDL_MEMORY_FONT];
+    int height = cache->top + 2 * (cache->height - cache->top);
+    nk_size size = (nk_size)cache->width * cache->height * 4;
+    SDL_RendererInfo info;
+    SDL_Texture *texture;
+    struct nk_font *font;
+    nk_byte *pixels;
+    int i, old_height = cache->height;
+
+    if (SDL_GetRendererInfo(sdl.renderer, &info) == 0 && info.max_texture_height)
+        height = NK_MIN(height, info.max_texture_height);
+    if (height <= cache->height) return 0;
+    pixels = (nk_byte*)alloc->alloc(alloc->userdata, 0, (nk_size)cache->width * height * 4);
+    if (!pixels) return 0;
+    NK_MEMCPY(pixels, cache->pixels, size);
+    NK_MEMSET(pixels + size, 0, (nk_size)cache->width * height * 4 - size);
+    texture = SDL_CreateTexture(sdl.renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, cache->width, height);
+    if (!texture) {
+        alloc->free(alloc->userdata, pixels);
+        return 0;
+    }
+    SDL_UpdateTexture(texture, NULL, pixels, 4 * cache->width);
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+    nk_sdl_pipeline_sync(1);
+    alloc->free(alloc->userdata, cache->pixels);
+    cache->pixels = pixels;
+    cache->height = height;
+    SDL_DestroyTexture(sdl.ogl.font_tex);
+    sdl.ogl.font_tex = texture;
+    sdl.ogl.tex_null.texture = nk_handle_ptr(texture);
+    for (font = sdl.atlas.fonts; font; font = font->next)
+        font->texture = font->handle.texture = nk_handle_ptr(texture);
+    for (i = 0; i < NK_CURSOR_COUNT; ++i)
+        sdl.atlas.cursors[i].img.handle = nk_handle_ptr(texture);
+    nk_sdl_glyph_rescale((float)old_height / (float)height);
+    cache->stats.grows++;
+    /* vertices converted before the swap point into the old texture */
+    nk_sdl_invalidate_geometry();
+    return 1;
+}
+
+/* Reserves a w x h rect for a glyph, rows are filled left to right. */
+NK_INTERN int
+nk_sdl_glyph_pack(int w, int h, int *x, int *y)
+{
+    struct nk_sdl_glyph_cache *cache = &sdl.glyphs;
+
+    if (w > cache->width) return 0;
+    if (cache->x + w > cache->width) {
+        cache->x = 0;
+        cache->y += cache->row + 1;
+        cache->row = 0;
+    }
+    while (cache->y + h > cache->height)
+        if (!nk_sdl_glyph_grow()) return 0;
+    *x = cache->x;
+    *y = cache->y;
+    cache->x += w + 1;
+    cache->row = NK_MAX(cache->row, h);
+    return 1;
+}
+
+NK_INTERN void
+nk_sdl_glyph_upload(struct nk_sdl_lazy_font *lf, int index, int x, int y, int w, int h)
+{
+    struct nk_sdl_glyph_cache *cache = &sdl.glyphs;
+    struct nk_allocator *alloc = &sdl.ogl.memory.alloc[NK_SDL_MEMORY_FONT];
+    nk_byte *alpha = (nk_byte*)alloc->alloc(alloc->userdata, 0, (nk_size)w * h);
+    SDL_Rect rect;
+    int i, j;
+
+    if (!alpha) return;
+    stbtt_MakeGlyphBitmap(&lf->info, alpha, w, h, w, lf->scale, lf->scale, index);
+    for (j = 0; j < h; ++j) {
+        /* white with coverage as alpha, as nk_font_atlas_bake() converts */
+        Uint32 *row = (Uint32*)(cache->pixels + ((nk_size)(y + j) * cache->width + x) * 4);
+        for (i = 0; i < w; ++i)
+            row[i] = ((Uint32)alpha[j * w + i] << 24) | 0x00FFFFFF;
+    }
+    alloc->free(alloc->userdata, alpha);
+
+    rect.x = x; rect.y = y; rect.w = w; rect.h = h;
+    SDL_UpdateTexture(sdl.ogl.font_tex, &rect, cache->pixels + ((nk_size)y * cache->width + x) * 4, 4 * cache->width);
+    cache->stats.uploads++;
+}
+
+NK_INTERN unsigned int
+nk_sdl_glyph_slot(nk_rune codepoint)
+{
+    return (codepoint * 2654435761u) & (2 * NK_SDL_GLYPH_CACHE_SIZE - 1);
+}
+
+/* Rasterizes a codepoint outside the baked ranges and records it, also when
+ * the font has no glyph for it, so it is only looked for once. */
+NK_INTERN const struct nk_font_glyph*
+nk_sdl_glyph_bake(struct nk_sdl_lazy_font *lf, nk_rune codepoint)
+{
+    struct nk_sdl_glyph_cache *cache = &sdl.glyphs;
+    struct nk_allocator *alloc = &sdl.ogl.memory.alloc[NK_SDL_MEMORY_FONT];
+    const struct nk_font_config *config = lf->font->config;
+    struct nk_sdl_lazy_glyph *entry;
+    struct nk_font_glyph *g;
+    int index, advance, lsb, x0, y0, x1, y1, x = 0, y = 0;
+    unsigned int slot;
+
+    if (!lf->table) {
+        struct nk_sdl_lazy_glyph *glyphs = (struct nk_sdl_lazy_glyph*)alloc->alloc(alloc->userdata, 0, sizeof(*glyphs) * NK_SDL_GLYPH_CACHE_SIZE);
+        int *table = (int*)alloc->alloc(alloc->userdata, 0, sizeof(int) * 2 * NK_SDL_GLYPH_CACHE_SIZE);
+        if (!glyphs || !table) {
+            if (glyphs) alloc->free(alloc->userdata, glyphs);
+            if (table) alloc->free(alloc->userdata, table);
+            return lf->font->fallback;
+        }
+        NK_MEMSET(table, 0, sizeof(int) * 2 * NK_SDL_GLYPH_CACHE_SIZE);
+        /* the worker only sees the table once it is empty and glyphs is set */
+        lf->glyphs = glyphs;
+        SDL_AtomicSetPtr((void**)&lf->table, table);
+    }
+    if (lf->count >= NK_SDL_GLYPH_CACHE_SIZE) return lf->font->fallback;
+
+    NK_SDL_TRACE_BEGIN("glyph bake");
+    entry = &lf->glyphs[lf->count];
+    NK_MEMSET(entry, 0, sizeof(*entry));
+    entry->codepoint = codepoint;
+    g = &entry->glyph;
+    index = stbtt_FindGlyphIndex(&lf->info, (int)codepoint);
+    if (index) {
+        stbtt_GetGlyphHMetrics(&lf->info, index, &advance, &lsb);
+        stbtt_GetGlyphBitmapBox(&lf->info, index, lf->scale, lf->scale, &x0, &y0, &x1, &y1);
+        if (x1 > x0 && y1 > y0) {
+            if (nk_sdl_glyph_pack(x1 - x0, y1 - y0, &x, &y))
+                nk_sdl_glyph_upload(lf, index, x, y, x1 - x0, y1 - y0);
+            else index = 0; /* the texture cannot grow any further */
+        }
+    }
+    entry->missing = !index;
+    if (index) {
+        /* the same layout nk_font_bake() produces */
+        g->codepoint = codepoint;
+        g->x0 = (float)x0;
+        g->y0 = (float)y0 + lf->font->info.ascent + 0.5f;
+        g->x1 = (float)x1;
+        g->y1 = (float)y1 + lf->font->info.ascent + 0.5f;
+        g->w = g->x1 - g->x0 + 0.5f;
+        g->h = g->y1 - g->y0;
+        g->u0 = (float)x / (float)cache->width;
+        g->v0 = (float)y / (float)cache->height;
+        g->u1 = (float)(x + x1 - x0) / (float)cache->width;
+        g->v1 = (float)(y + y1 - y0) / (float)cache->height;
+        g->xadvance = (float)advance * lf->scale + config->spacing.x;
+        if (config->pixel_snap)
+            g->xadvance = (float)(int)(g->xadvance + 0.5f);
+        cache->stats.lazy++;
+    } else cache->stats.missing++;
+
+    /* publish the entry last, the worker may be probing the table */
+    for (slot = nk_sdl_glyph_slot(codepoint); lf->table[slot]; slot = (slot + 1) & (2 * NK_SDL_GLYPH_CACHE_SIZE - 1));
+    lf->count++;
+    SDL_MemoryBarrierRelease();
+    lf->table[slot] = lf->count;
+    NK_SDL_TRACE_END();
+    return entry->missing ? lf->font->fallback : g;
+}
+
+/* Baked glyph, lazy glyph or, with bake set, a freshly rasterized one. The
+ * pipeline worker passes bake = 0: text is measured, and so baked, on the
+ * main thread before it is drawn. */
+NK_INTERN const struct nk_font_glyph*
+nk_sdl_glyph_find(struct nk_sdl_lazy_font *lf, nk_rune codepoint, int bake)
+{
+    struct nk_sdl_glyph_cache *cache = &sdl.glyphs;
+    struct nk_font *font = lf->font;
+    const struct nk_font_glyph *g = nk_font_find_glyph(font, codepoint);
+    unsigned int slot;
+
+    if (g == font->fallback && codepoint != font->fallback_codepoint) {
+        /* outside the baked ranges; pairs with the release in nk_sdl_glyph_bake() */
+        int *table = (int*)SDL_AtomicGetPtr((void**)&lf->table);
+        int index;
+        g = NULL;
+        for (slot = nk_sdl_glyph_slot(codepoint); table && (index = table[slot]) != 0; slot = (slot + 1) & (2 * NK_SDL_GLYPH_CACHE_SIZE - 1)) {
+            const struct nk_sdl_lazy_glyph *entry;
+            SDL_MemoryBarrierAcquire();
+            entry = &lf->glyphs[index - 1];
+            if (entry->codepoint == codepoint) {
+                g = entry->missing ? font->fallback : &entry->glyph;
+                break;
+            }
+        }
+    }
+
+    if (!bake) return g ? g : font->fallback;
+    if (g) {
+        cache->stats.hits++;
+        return g;
+    }
+    cache->stats.misses++;
+    return nk_sdl_glyph_bake(lf, codepoint);
+}
+
+NK_INTERN float
+nk_sdl_glyph_text_width(nk_handle handle, float height, const char *text, int len)
+{
+    struct nk_sdl_lazy_font *lf = (struct nk_sdl_lazy_font*)handle.ptr;
+    nk_rune unicode;
+    int text_len = 0, glyph_len;
+    float text_width = 0, scale;
+
+    if (!text || !len) return 0;
+    scale = height / lf->font->info.height;
+    glyph_len = text_len = nk_utf_decode(text, &unicode, len);
+    while (text_len <= len && glyph_len && unicode != NK_UTF_INVALID) {
+        text_width += nk_sdl_glyph_find(lf, unicode, 1)->xadvance * scale;
+        glyph_len = nk_utf_decode(text + text_len, &unicode, len - text_len);
+        text_len += glyph_len;
+    }
+    return text_width;
+}
+
+NK_INTERN void
+nk_sdl_glyph_query(nk_handle handle, float height, struct nk_user_font_glyph *glyph,
+    nk_rune codepoint, nk_rune next_codepoint)
+{
+    struct nk_sdl_lazy_font *lf = (struct nk_sdl_lazy_font*)handle.ptr;
+    const struct nk_font_glyph *g = nk_sdl_glyph_find(lf, codepoint, !sdl.ogl.pipe.enabled);
+    float scale = height / lf->font->info.height;
+
+    NK_UNUSED(next_codepoint);
+    glyph->width = (g->x1 - g->x0) * scale;
+    glyph->height = (g->y1 - g->y0) * scale;
+    glyph->offset = nk_vec2(g->x0 * scale, g->y0 * scale);
+    glyph->xadvance = g->xadvance * scale;
+    glyph->uv[0] = nk_vec2(g->u0, g->v0);
+    glyph->uv[1] = nk_vec2(g->u1, g->v1);
+}
+
+/* After nk_font_atlas_end(): fits the baked coordinates to the taller texture
+ * and routes the fonts' measuring and glyph queries through the lazy glyphs. */
+NK_INTERN void
+nk_sdl_glyph_cache_attach(void)
+{
+    struct nk_sdl_glyph_cache *cache = &sdl.glyphs;
+    struct nk_allocator *alloc = &sdl.ogl.memory.alloc[NK_SDL_MEMORY_FONT];
+    struct nk_font *font;
+    int i = 0;
+
+    nk_sdl_glyph_rescale((float)(cache->top - 1) / (float)cache->height);
+    cache->font_count = 0;
+    for (font = sdl.atlas.fonts; font; font = font->next) cache->font_count++;
+    cache->fonts = (struct nk_sdl_lazy_font*)alloc->alloc(alloc->userdata, 0, sizeof(*cache->fonts) * (nk_size)cache->font_count);
+    if (!cache->fonts) {
+        cache->font_count = 0;
+        return;
+    }
+    NK_MEMSET(cache->fonts, 0, sizeof(*cache->fonts) * (nk_size)cache->font_count);
+    for (font = sdl.atlas.fonts; font; font = font->next, ++i) {
+        struct nk_sdl_lazy_font *lf = &cache->fonts[i];
+        const struct nk_font_config *config = font->config;
+        const unsigned char *ttf = (const unsigned char*)config->ttf_blob;
+        lf->font = font;
+        if (!stbtt_InitFont(&lf->info, ttf, stbtt_GetFontOffsetForIndex(ttf, 0))) continue;
+        lf->info.userdata = alloc;
+        lf->scale = stbtt_ScaleForPixelHeight(&lf->info, config->size);
+        font->handle.userdata = nk_handle_ptr(lf);
+        font->handle.width = nk_sdl_glyph_text_width;
+        font->handle.query = nk_sdl_glyph_query;
+    }
+    cache->stats.baked = sdl.atlas.glyph_count;
+}
+
+NK_INTERN void
+nk_sdl_glyph_cache_free(void)
+{
+    struct nk_sdl_glyph_cache *cache = &sdl.glyphs;
+    struct nk_allocator *alloc = &sdl.ogl.memory.alloc[NK_SDL_MEMORY_FONT];
+    int i;
+
+    for (i = 0; i < cache->font_count; ++i) {
+        if (cache->fonts[i].glyphs) alloc->free(alloc->userdata, cache->fonts[i].glyphs);
+        if (cache->fonts[i].table) alloc->free(alloc->userdata, cache->fonts[i].table);
+    }
+    if (cache->fonts) alloc->free(alloc->userdata, cache->fonts);
+    if (cache->pixels) alloc->free(alloc->userdata, cache->pixels);
+    cache->stats.lazy = cache->stats.missing = 0;
+    cache->fonts = NULL;
+    cache->font_count = 0;
+    cache->pixels = NULL;
+}
+
+NK_API void
+nk_sdl_set_lazy_glyphs(int enable)
+{
+    sdl.glyphs.enabled = enable;
+}
+
+NK_API void
+nk_sdl_glyph_stats(struct nk_sdl_glyph_stats *stats)
+{
+    *stats = sdl.glyphs.stats;
+    stats->width = sdl.glyphs.pixels ? sdl.glyphs.width : 0;
+    stats->height = sdl.glyphs.pixels ? sdl.glyphs.height : 0;
+}
+
 NK_API void
 nk_sdl_font_stash_begin(struct nk_font_atlas **atlas)
 {
-    nk_font_atlas_init_default(&sdl.atlas);
+    nk_font_atlas_init(&sdl.atlas, &sdl.ogl.memory.alloc[NK_SDL_MEMORY_FONT]);
     nk_font_atlas_begin(&sdl.atlas);
     *atlas = &sdl.atlas;
 }
 
-NK_API void
-nk_sdl_font_stash_end(void)
+/* Everything up to the texture upload: loads the atlas from the cache or
+ * bakes it, and stores a fresh bake. Touches no SDL renderer state, so it
+ * runs on the re-bake thread too. */
+NK_INTERN void
+nk_sdl_font_bake_prepare(struct nk_sdl_font_bake *bake, struct nk_font_atlas *atlas)
 {
-    const void *image; int w, h;
-    image = nk_font_atlas_bake(&sdl.atlas, &w, &h, NK_FONT_ATLAS_RGBA32);
-    nk_sdl_device_upload_atlas(image, w, h);
+    Uint64 start = SDL_GetPerformanceCounter();
+    Uint64 key = 0;
+
+    NK_MEMSET(&bake->stats, 0, sizeof(bake->stats));
+    bake->map.data = NULL;
+    bake->image = NULL;
+    if (sdl.font_cache.dir[0] && atlas->font_num) {
+        key = nk_sdl_font_cache_key(atlas);
+        NK_SDL_TRACE_BEGIN("font cache load");
+        bake->stats.hit = nk_sdl_font_cache_load(atlas, key, &bake->map);
+        NK_SDL_TRACE_END();
+    }
+    if (bake->stats.hit) {
+        /* straight from the page cache into the texture */
+        bake->image = bake->map.data + bake->map.size - (nk_size)atlas->tex_width * atlas->tex_height * 4;
+    } else {
+        int w, h;
+        NK_SDL_TRACE_BEGIN("font bake");
+        bake->image = nk_font_atlas_bake(atlas, &w, &h, NK_FONT_ATLAS_RGBA32);
+        NK_SDL_TRACE_END();
+        if (key && bake->image)
+            bake->stats.stored = nk_sdl_font_cache_store(atlas, key, bake->image);
+    }
+    bake->stats.ms = nk_sdl_elapsed_ms(start, SDL_GetPerformanceCounter());
+}
+
+/* Uploads the prepared sdl.atlas and makes its default font the style font. */
+NK_INTERN void
+nk_sdl_font_bake_finish(struct nk_sdl_font_bake *bake)
+{
+    const struct nk_font_config *config;
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    for (config = sdl.atlas.config; config; config = config->next)
+        if (config->coord_type == NK_COORD_PIXEL) sdl.glyphs.enabled = 0; /* not rescalable */
+    if (bake->image)
+        nk_sdl_device_upload_atlas(bake->image, sdl.atlas.tex_width, sdl.atlas.tex_height);
+    nk_sdl_unmap_file(&bake->map);
     nk_font_atlas_end(&sdl.atlas, nk_handle_ptr(sdl.ogl.font_tex), &sdl.ogl.tex_null);
+    if (sdl.glyphs.enabled && sdl.glyphs.pixels)
+        nk_sdl_glyph_cache_attach();
     if (sdl.atlas.default_font)
         nk_style_set_font(&sdl.ctx, &sdl.atlas.default_font->handle);
+    bake->stats.ms += nk_sdl_elapsed_ms(start, SDL_GetPerformanceCounter());
+    sdl.font_cache.stats = bake->stats;
+}
+
+NK_API void
+nk_sdl_font_stash_end(void)
+{
+    struct nk_sdl_font_bake bake;
+    nk_sdl_font_bake_prepare(&bake, &sdl.atlas);
+    nk_sdl_font_bake_finish(&bake);
+}
+
+NK_INTERN int SDLCALL
+nk_sdl_font_rebake_worker(void *data)
+{
+    struct nk_sdl_font_rebake *rebake = (struct nk_sdl_font_rebake*)data;
+    NK_SDL_TRACE_THREAD("nk_sdl font bake");
+    nk_font_atlas_begin(&rebake->atlas);
+    rebake->setup(&rebake->atlas, rebake->userdata);
+    nk_sdl_font_bake_prepare(&rebake->bake, &rebake->atlas);
+    SDL_AtomicSet(&rebake->done, 1);
+    return 0;
+}
+
+NK_API int
+nk_sdl_font_rebake(nk_sdl_font_setup setup, void *userdata)
+{
+    struct nk_sdl_font_rebake *rebake = &sdl.rebake;
+
+    if (rebake->thread) return 0;
+    nk_font_atlas_init(&rebake->atlas, &sdl.ogl.memory.alloc[NK_SDL_MEMORY_FONT]);
+    rebake->setup = setup;
+    rebake->userdata = userdata;
+    SDL_AtomicSet(&rebake->done, 0);
+    rebake->thread = SDL_CreateThread(nk_sdl_font_rebake_worker, "nk_sdl_font_bake", rebake);
+    if (!rebake->thread) {
+        SDL_Log("error creating font bake thread: %s", SDL_GetError());
+        nk_font_atlas_clear(&rebake->atlas);
+        return 0;
+    }
+    return 1;
+}
+
+NK_API int
+nk_sdl_font_rebaking(void)
+{
+    return sdl.rebake.thread != NULL;
+}
+
+/* Joins the re-bake thread and drops its atlas. */
+NK_INTERN void
+nk_sdl_font_rebake_cancel(void)
+{
+    struct nk_sdl_font_rebake *rebake = &sdl.rebake;
+
+    if (!rebake->thread) return;
+    SDL_WaitThread(rebake->thread, NULL);
+    rebake->thread = NULL;
+    nk_sdl_unmap_file(&rebake->bake.map);
+    nk_font_atlas_clear(&rebake->atlas);
+}
+
+NK_API struct nk_font_atlas*
+nk_sdl_font_rebake_poll(void)
+{
+    struct nk_sdl_font_rebake *rebake = &sdl.rebake;
+
+    if (!rebake->thread || !SDL_AtomicGet(&rebake->done)) return NULL;
+    if (!rebake->bake.image) {
+        SDL_Log("font re-bake failed, keeping the current atlas");
+        nk_sdl_font_rebake_cancel();
+        return NULL;
+    }
+    SDL_WaitThread(rebake->thread, NULL);
+    rebake->thread = NULL;
+
+    NK_SDL_TRACE_BEGIN("font swap");
+    /* the worker may still convert text of the old fonts */
+    nk_sdl_pipeline_sync(1);
+    nk_sdl_glyph_cache_free();
+    nk_font_atlas_clear(&sdl.atlas);
+    SDL_DestroyTexture(sdl.ogl.font_tex);
+    sdl.ogl.font_tex = NULL;
+    /* fonts point at their glyphs and configs, never back at the atlas */
+    sdl.atlas = rebake->atlas;
+    nk_sdl_font_bake_finish(&rebake->bake);
+    nk_sdl_invalidate_geometry();
+    NK_SDL_TRACE_END();
+    return &sdl.atlas;
 }
 
 NK_API int
@@ -360,6 +3352,12 @@ nk_sdl_handle_event(SDL_Event *evt)
         case SDL_MOUSEWHEEL:
             nk_input_scroll(ctx,nk_vec2((float)evt->wheel.x,(float)evt->wheel.y));
             return 1;
+
+        case SDL_WINDOWEVENT: /* contents may be lost or stale, force the next frame out */
+        case SDL_RENDER_TARGETS_RESET:
+        case SDL_RENDER_DEVICE_RESET:
+            nk_sdl_invalidate();
+            return 0;
     }
     return 0;
 }
@@ -368,11 +3366,23 @@ NK_API
 void nk_sdl_shutdown(void)
 {
     struct nk_sdl_device *dev = &sdl.ogl;
+    /* join the worker first, a frame in flight still reads fonts and glyphs */
+    nk_sdl_set_pipelined(0);
+    nk_sdl_font_rebake_cancel();
+    nk_sdl_glyph_cache_free();
     nk_font_atlas_clear(&sdl.atlas);
     nk_free(&sdl.ctx);
     SDL_DestroyTexture(dev->font_tex);
     /* glDeleteTextures(1, &dev->font_tex); */
     nk_buffer_free(&dev->cmds);
+    nk_buffer_free(&dev->vbuf.buf);
+    nk_buffer_free(&dev->ebuf.buf);
+    nk_buffer_free(&dev->batches);
+    nk_buffer_free(&dev->damage.items[0]);
+    nk_buffer_free(&dev->damage.items[1]);
+    if (dev->damage.target) SDL_DestroyTexture(dev->damage.target);
+    nk_sdl_set_window_cache(0);
+    free(dev->memory.arena.base);
     memset(&sdl, 0, sizeof(sdl));
 }
 
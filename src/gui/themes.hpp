@@ -2,21 +2,83 @@
 
 #include "../tinyfd/tinyfiledialogs.h"
 
+// Values of a "r, g, b, a" tuple as written by saveTheme(). On failure
+// `error` says what is wrong and `error_pos` is the offset into the input.
 template<typename T>
-std::vector<T> ExtractNumbers(const std::string& input) {
-    std::regex separator("[\\s,]+");
-    std::sregex_token_iterator it(input.begin(), input.end(), separator, -1);
-    std::sregex_token_iterator end;
-
-    std::vector<T> numbers;
-    for (; it != end; ++it) {
-        std::istringstream iss(*it);
-        T number;
-        if (iss >> std::boolalpha >> number)
-            numbers.push_back(number);
-    }
+struct ColorTuple {
+    T values[4] = {};
+    int count = 0;
+    const char* error = NULL;
+    size_t error_pos = 0;
+};
+
+static bool ColorTupleSeparator(char c)
+{
+    return c == ',' || c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+}
 
-    return numbers;
+static const char* ColorTupleNumber(const char* first, const char* last, int& value)
+{
+    std::from_chars_result result = std::from_chars(first, last, value);
+    return result.ec == std::errc() ? result.ptr : NULL;
+}
+
+static const char* ColorTupleNumber(const char* first, const char* last, float& value)
+{
+#ifdef __cpp_lib_to_chars
+    std::from_chars_result result = std::from_chars(first, last, value);
+    return result.ec == std::errc() ? result.ptr : NULL;
+#else
+    // no floating point from_chars in this standard library
+    char text[64];
+    size_t length = std::min((size_t)(last - first), sizeof(text) - 1);
+    memcpy(text, first, length);
+    text[length] = '\0';
+    char* end;
+    value = strtof(text, &end);
+    return end == text ? NULL : first + (end - text);
+#endif
+}
+
+// Parses min_count to 4 numbers separated by commas and/or whitespace. The
+// first `checked` values must lie within [lo, hi]. Does not allocate.
+template<typename T>
+ColorTuple<T> ParseColorTuple(std::string_view input, int min_count, T lo, T hi, int checked = 4)
+{
+    ColorTuple<T> tuple;
+    const char* first = input.data();
+    const char* last = first + input.size();
+    const char* p = first;
+    for (;;) {
+        while (p != last && ColorTupleSeparator(*p))
+            p++;
+        if (p == last)
+            break;
+        if (tuple.count == 4) {
+            tuple.error = "too many values";
+            tuple.error_pos = p - first;
+            return tuple;
+        }
+        T value;
+        const char* end = ColorTupleNumber(p, last, value);
+        if (!end || (end != last && !ColorTupleSeparator(*end))) {
+            tuple.error = "not a number";
+            tuple.error_pos = p - first;
+            return tuple;
+        }
+        if (tuple.count < checked && (value < lo || value > hi)) {
+            tuple.error = "out of range";
+            tuple.error_pos = p - first;
+            return tuple;
+        }
+        tuple.values[tuple.count++] = value;
+        p = end;
+    }
+    if (tuple.count < min_count) {
+        tuple.error = "too few values";
+        tuple.error_pos = input.size();
+    }
+    return tuple;
 }
 
 int global_theme_reset = nk_false;
@@ -73,6 +135,7 @@ void setup_color_text() {
 struct nk_color theme[NK_COLOR_COUNT];
 nk_colorf color_float[NK_COLOR_COUNT];
 bool theme_initialized = false;
+bool unattended = false; // --headless: errors go to the log, config.ini is never written
 static int reset_bgcolor_popup = nk_false;
 static int reset_appcolor_popup[static_cast<int>(nk_style_colors::NK_COLOR_COUNT)];
 static int appcolorpicker_popup[static_cast<int>(nk_style_colors::NK_COLOR_COUNT)];
@@ -121,117 +184,225 @@ void SetupDefaultTheme() {
     setup_color_text();
 }
 
-int loadTheme(const char* fname) {
+// Binary themes (.nkt): a fixed header, the color table as RGBA8, the
+// background as four floats, then optional metadata as "key=value" lines.
+// All fields are little-endian, like every platform the editor builds for.
+// The checksum (FNV-1a) covers everything after the header, so truncated or
+// damaged files are rejected. Files are read in place from a read-only
+// mapping, and written to a temporary file that is renamed over the target.
+#define NKT_MAGIC 0x31544b4eu               // "NKT1"
+#define NKT_VERSION 1
+
+struct NktHeader {
+    Uint32 magic;
+    Uint16 version;
+    Uint16 color_count;                     // colors in the table, at least NK_COLOR_COUNT
+    Uint32 checksum;
+    Uint32 meta_size;                       // metadata bytes after the background
+};
+static_assert(sizeof(NktHeader) == 16, "NktHeader must not be padded");
+
+static Uint32 NktChecksum(const unsigned char* data, size_t size)
+{
+    Uint32 hash = 2166136261u;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ data[i]) * 16777619u;
+    return hash;
+}
+
+static bool IsBinaryThemeName(const char* fname)
+{
+    return std::filesystem::path(fname).extension() == ".nkt";
+}
+
+static bool ParseBinaryTheme(const struct nk_sdl_file_map& map, const char* fname, struct nk_color colors[NK_COLOR_COUNT], struct nk_colorf& background, std::string& error) {
+    std::ostringstream oss;
+    NktHeader header;
+    if (map.size < sizeof(header)) {
+        oss << "Truncated header in " << fname << std::endl;
+        error = oss.str();
+        return false;
+    }
+    memcpy(&header, map.data, sizeof(header));
+    size_t table = (size_t)header.color_count * 4 + 4 * sizeof(float);
+    if (header.version != NKT_VERSION) {
+        oss << "Unsupported version " << header.version << " of " << fname << std::endl;
+        error = oss.str();
+        return false;
+    }
+    if (header.color_count < NK_COLOR_COUNT || map.size != sizeof(header) + table + header.meta_size) {
+        oss << "Invalid size of " << fname << std::endl;
+        error = oss.str();
+        return false;
+    }
+    if (NktChecksum(map.data + sizeof(header), map.size - sizeof(header)) != header.checksum) {
+        oss << "Checksum mismatch in " << fname << std::endl;
+        error = oss.str();
+        return false;
+    }
+
+    // colors added after NK_COLOR_COUNT by a newer nuklear are skipped
+    const unsigned char* p = map.data + sizeof(header);
+    for (int i = 0; i < NK_COLOR_COUNT; i++)
+        colors[i] = nk_rgba(p[i * 4], p[i * 4 + 1], p[i * 4 + 2], p[i * 4 + 3]);
+    float values[4];
+    memcpy(values, p + header.color_count * 4, sizeof(values));
+    background = { values[0], values[1], values[2], values[3] };
+    return true;
+}
+
+static bool WriteBinaryTheme(const char* fname, const struct nk_color colors[NK_COLOR_COUNT], const struct nk_colorf& background, std::string& error) {
+    std::string meta = "name=" + std::filesystem::path(fname).stem().string() + "\n";
+    std::vector<unsigned char> body(NK_COLOR_COUNT * 4 + 4 * sizeof(float) + meta.size());
+    for (int i = 0; i < NK_COLOR_COUNT; i++) {
+        body[i * 4] = colors[i].r;
+        body[i * 4 + 1] = colors[i].g;
+        body[i * 4 + 2] = colors[i].b;
+        body[i * 4 + 3] = colors[i].a;
+    }
+    float values[4] = { background.r, background.g, background.b, background.a };
+    memcpy(&body[NK_COLOR_COUNT * 4], values, sizeof(values));
+    memcpy(&body[NK_COLOR_COUNT * 4 + sizeof(values)], meta.data(), meta.size());
+
+    NktHeader header;
+    header.magic = NKT_MAGIC;
+    header.version = NKT_VERSION;
+    header.color_count = NK_COLOR_COUNT;
+    header.checksum = NktChecksum(body.data(), body.size());
+    header.meta_size = (Uint32)meta.size();
+
+    // a reader sees either the old file or the complete new one
+    std::string tmp = std::string(fname) + ".tmp";
+    FILE* file = fopen(tmp.c_str(), "wb");
+    bool ok = file && fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(body.data(), body.size(), 1, file) == 1;
+#if !defined(_WIN32)
+    ok = ok && fflush(file) == 0 && fsync(fileno(file)) == 0;
+#endif
+    ok = file && fclose(file) == 0 && ok;
+    std::error_code ec;
+    if (ok)
+        std::filesystem::rename(tmp, fname, ec);
+    if (!ok || ec) {
+        std::filesystem::remove(tmp, ec);
+        std::ostringstream oss;
+        oss << "Failed to write " << fname << std::endl;
+        error = oss.str();
+        return false;
+    }
+    return true;
+}
+
+// Reads and validates a theme file, INI or binary, without touching the
+// current theme or showing a dialog, so the theme library can run it on worker
+// threads. On failure `error` says why, worded for the message box.
+bool ParseThemeFile(const char* fname, struct nk_color colors[NK_COLOR_COUNT], struct nk_colorf& background, std::string& error) {
+    TRACE_SCOPE("ParseThemeFile");
+    // binary themes are recognized by their magic, whatever the extension
+    struct nk_sdl_file_map map;
+    if (nk_sdl_map_file(&map, fname)) {
+        Uint32 magic = 0;
+        memcpy(&magic, map.data, std::min(map.size, sizeof(magic)));
+        if (magic == NKT_MAGIC) {
+            bool ok = ParseBinaryTheme(map, fname, colors, background, error);
+            nk_sdl_unmap_file(&map);
+            return ok;
+        }
+        nk_sdl_unmap_file(&map);
+    }
+
+    std::ostringstream oss;
     portini::Document doc;
     if (!doc.ParseFromFile(fname)) {
-        std::ostringstream oss;
         oss << "Failed to load " << fname << std::endl;
-        const std::string result = oss.str();
-        tinyfd_messageBox("Error", result.c_str(), "ok", "error", 1);
-        return 0;
+        error = oss.str();
+        return false;
     }
 
     if (!doc.HasSection("theme")) {
-        std::ostringstream oss;
         oss << "Missing [theme] section in " << fname << std::endl;
-        const std::string result = oss.str();
-        tinyfd_messageBox("Error", result.c_str(), "ok", "error", 1);
-        return 0;
+        error = oss.str();
+        return false;
     }
     portini::Section& themeSection = doc.GetSection("theme");
 
     int idx = 0;
     for (const auto& color : nk_color_strings) {
         if (!themeSection.HasKey(nk_color_strings.at(idx))) {
-            std::ostringstream oss;
             oss << "Missing key " << color << " in [theme] section" << std::endl;
-            const std::string result = oss.str();
-            tinyfd_messageBox("Error", result.c_str(), "ok", "error", 1);
-            return 0;
+            error = oss.str();
+            return false;
         }
         portini::Key key = themeSection.GetKey(color);
         std::string value = key.GetValue();
-        std::istringstream iss(value);
-        // Extract integers
-        std::vector<int> integers = ExtractNumbers<int>(value);
-
-        // Printing the extracted integers
-        auto amount = integers.size();
-        if (amount != 4)
+        ColorTuple<int> tuple = ParseColorTuple<int>(value, 4, 0, 255);
+        if (tuple.error)
         {
-            std::ostringstream oss;
-            oss << "Invalid value " << value << " for key " << color << "`` in [theme] section" << std::endl;
-            const std::string result = oss.str();
-            tinyfd_messageBox("Error", result.c_str(), "ok", "error", 1);
-            return 0;
-        }
-        for (int i = 0; i < amount; ++i) {
-            if (integers[i] > 255 || integers[i] < 0)
-            {
-                std::ostringstream oss;
-                oss << "Invalid value " << value << " for key " << color << "`` in [theme] section" << std::endl << "Out-of-range: " << i << "=" << integers[i] << std::endl;
-                const std::string result = oss.str();
-                tinyfd_messageBox("Error", result.c_str(), "ok", "error", 1);
-                return 0;
-            }
+            oss << "Invalid value " << value << " for key " << color << "`` in [theme] section" << std::endl << tuple.error << " at column " << tuple.error_pos + 1 << std::endl;
+            error = oss.str();
+            return false;
         }
 
-        theme[idx].r = integers[0]; // Red
-        theme[idx].g = integers[1]; // Green
-        theme[idx].b = integers[2]; // Blue
-        theme[idx].a = integers[3]; // Alpha
+        colors[idx].r = tuple.values[0]; // Red
+        colors[idx].g = tuple.values[1]; // Green
+        colors[idx].b = tuple.values[2]; // Blue
+        colors[idx].a = tuple.values[3]; // Alpha
         idx++;
     }
 
     if (!doc.HasSection("background")) {
-        std::ostringstream oss;
         oss << "Missing [background] section in " << fname << std::endl;
-        const std::string result = oss.str();
-        tinyfd_messageBox("Error", result.c_str(), "ok", "error", 1);
-        return 0;
+        error = oss.str();
+        return false;
     }
     portini::Section& backgroundSection = doc.GetSection("background");
 
     if (!backgroundSection.HasKey("bg")) {
-        tinyfd_messageBox("Error", "Missing key bg`` in [background] section", "ok", "error", 1);
-        return 0;
+        error = "Missing key bg`` in [background] section";
+        return false;
     }
     const portini::Key bgKey = backgroundSection.GetKey("bg");
 
-    // Extract floats
+    // alpha is not range checked as it has no effect here
     std::string bgValue = bgKey.GetValue();
-    std::vector<float> floats = ExtractNumbers<float>(bgValue);
-
-    auto bgfloats = floats.size();
-    if (bgfloats != 4 && bgfloats != 3) {
-        std::ostringstream oss;
-        oss << "Invalid value " << bgValue << " for key bg`` in [background] section" << std::endl;
-        const std::string result = oss.str();
-        tinyfd_messageBox("Error", result.c_str(), "ok", "error", 1);
-        return 0;
+    ColorTuple<float> bgTuple = ParseColorTuple<float>(bgValue, 3, -0.1f, 1.1f, 3);
+    if (bgTuple.error) {
+        oss << "Invalid value " << bgValue << " for key bg`` in [background] section" << std::endl << bgTuple.error << " at column " << bgTuple.error_pos + 1 << std::endl;
+        error = oss.str();
+        return false;
     }
 
-    for (int i = 0; i < 3; ++i) {
-        // skip 'alpha' as it has no effect here
-        if (floats[i] > 1.1f || floats[i] < -0.1f)
-        {
-            std::ostringstream oss;
-            oss << "Invalid value " << floats[i] << " for key bg`` in [background] section" << std::endl << "Out-of-range: " << i << "=" << floats[i] << std::endl;
-            const std::string result = oss.str();
-            tinyfd_messageBox("Error", result.c_str(), "ok", "error", 1);
-            return 0;
-        }
-    }
+    background.r = bgTuple.values[0];
+    background.g = bgTuple.values[1];
+    background.b = bgTuple.values[2];
+    background.a = bgTuple.count == 4 ? bgTuple.values[3] : DEFAULT_COLOR_ALPHA * 255;
 
-    bg.r = floats[0];
-    bg.g = floats[1];
-    bg.b = floats[2];
-    bg.a = floats[3];
+    return true;
+}
+
+int loadTheme(const char* fname) {
+    TRACE_SCOPE("loadTheme");
+    struct nk_color colors[NK_COLOR_COUNT];
+    struct nk_colorf background;
+    std::string error;
+    if (!ParseThemeFile(fname, colors, background, error)) {
+        if (unattended)
+            SDL_Log("%s", error.c_str());
+        else
+            tinyfd_messageBox("Error", error.c_str(), "ok", "error", 1);
+        return 0;
+    }
 
+    memcpy(theme, colors, sizeof(theme));
+    bg = background;
     return 1;
 }
-void saveTheme(const char* fname)
+// Writes a theme as binary if the name ends in .nkt, else as INI.
+bool WriteThemeFile(const char* fname, const struct nk_color colors[NK_COLOR_COUNT], const struct nk_colorf& background, std::string& error)
 {
+    TRACE_SCOPE("WriteThemeFile");
+    if (IsBinaryThemeName(fname))
+        return WriteBinaryTheme(fname, colors, background, error);
+
     portini::Document doc;
     portini::Section& themeSection = doc.CreateSection("theme");
 
@@ -239,10 +410,10 @@ void saveTheme(const char* fname)
     for (auto& color : nk_color_strings) {
         std::string key = color;
         std::stringstream value;
-        value << std::to_string(theme[i].r) << ", ";
-        value << std::to_string(theme[i].g) << ", ";
-        value << std::to_string(theme[i].b) << ", ";
-        value << std::to_string(theme[i].a);
+        value << std::to_string(colors[i].r) << ", ";
+        value << std::to_string(colors[i].g) << ", ";
+        value << std::to_string(colors[i].b) << ", ";
+        value << std::to_string(colors[i].a);
         themeSection.CreateKey(key) = value.str();
         i++;
     }
@@ -250,13 +421,27 @@ void saveTheme(const char* fname)
     portini::Section& backgroundSection = doc.CreateSection("background");
 
     std::stringstream value;
-    value << std::to_string(bg.r) << ", ";
-    value << std::to_string(bg.g) << ", ";
-    value << std::to_string(bg.b) << ", ";
-    value << std::to_string(bg.a);
+    value << std::to_string(background.r) << ", ";
+    value << std::to_string(background.g) << ", ";
+    value << std::to_string(background.b) << ", ";
+    value << std::to_string(background.a);
     backgroundSection.CreateKey("bg") = value.str();
 
-    doc.SerializeToFile(fname);
+    if (!doc.SerializeToFile(fname)) {
+        std::ostringstream oss;
+        oss << "Failed to write " << fname << std::endl;
+        error = oss.str();
+        return false;
+    }
+    return true;
+}
+
+void saveTheme(const char* fname)
+{
+    TRACE_SCOPE("saveTheme");
+    std::string error;
+    if (!WriteThemeFile(fname, theme, bg, error))
+        tinyfd_messageBox("Error", error.c_str(), "ok", "error", 1);
 }
 
 void ResetThemeColor(int& color_idx, struct nk_context* ctx)
@@ -11,6 +11,12 @@
 #include <utility>
 #include <vector>
 
+// Tracing hook, define it before including this file to record a span for
+// the scope it is used in.
+#ifndef PORTINI_TRACE_SCOPE
+#define PORTINI_TRACE_SCOPE(name)
+#endif
+
 namespace portini {
 
 namespace internal {
@@ -241,6 +247,7 @@ public:
 	using Iterator = typename Container::iterator;
 
 	bool ParseFromFile(const Ch* filename) {
+		PORTINI_TRACE_SCOPE("ini parse");
 		std::basic_ifstream<Ch> ifs(filename);
 		if (!ifs.is_open()) {
 			return false;
@@ -258,6 +265,7 @@ public:
 	}
 
 	bool SerializeToFile(const Ch* filename) const {
+		PORTINI_TRACE_SCOPE("ini write");
 		std::basic_ofstream<Ch> ofs(filename, std::ios_base::binary);
 		if (!ofs.is_open()) {
 			return false;
@@ -368,7 +376,7 @@ private:
 			return true;
 		} else {
 			auto pos = line.find('=');
-			if (pos == std::basic_string<Ch>::npos) {
+			if (pos == std::basic_string<Ch>::npos || *ctx == nullptr) {
 				return false;
 			}
 
@@ -1,5 +1,18 @@
 #include "main.hpp"
 #include "common/overview.hpp"
+#include "common/idle.hpp"
+#include "common/latency.hpp"
+#include "common/library.hpp"
+#include "common/browser.hpp"
+#include "common/watch.hpp"
+#include "common/input.hpp"
+#include "common/headless.hpp"
+#include "common/profiler.hpp"
+#include "common/memory.hpp"
+#include "common/allocs.hpp"
+#include "common/dpi.hpp"
+#include "common/convert.hpp"
+#include "common/bench.hpp"
 #if defined(_WIN32)
 int wmain(int argc, char* argv[])
 {
@@ -19,84 +32,81 @@ int main(int argc, char* argv[])
     /* GUI */
     struct nk_context* ctx;
 
+    int converted = ParseConvertArgs(argc, argv);
+    if (converted >= 0)
+        return converted;
+    int benched = ParseBenchArgs(argc, argv);
+    if (benched >= 0)
+        return benched;
+    if (!ParseAllocArgs(argc, argv) || !ParseHeadlessArgs(argc, argv) || !ParseTraceArgs(argc, argv))
+        exit(-1);
+    ParseLatencyArgs(argc, argv);
+
     /* SDL setup */
-    SDL_SetHint(SDL_HINT_VIDEO_HIGHDPI_DISABLED, "0");
-    SDL_Init(SDL_INIT_VIDEO);
+    if (headless.enabled) {
+        unattended = true;
+        /* no window and no video subsystem, only events for the input queue */
+        SDL_Init(SDL_INIT_EVENTS);
+        win = NULL;
+        renderer = HeadlessCreateRenderer();
+
+        if (renderer == NULL) {
+            SDL_Log("Error SDL_CreateSoftwareRenderer %s", SDL_GetError());
+            exit(-1);
+        }
+    } else {
+        SDL_SetHint(SDL_HINT_VIDEO_HIGHDPI_DISABLED, "0");
+        SDL_Init(SDL_INIT_VIDEO);
 
-    win = SDL_CreateWindow("Demo",
-        SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-        WINDOW_MIN_WIDTH, WINDOW_MIN_HEIGHT, SDL_WINDOW_SHOWN | SDL_WINDOW_ALLOW_HIGHDPI | SDL_WINDOW_RESIZABLE);
+        win = SDL_CreateWindow("Demo",
+            SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+            WINDOW_MIN_WIDTH, WINDOW_MIN_HEIGHT, SDL_WINDOW_SHOWN | SDL_WINDOW_ALLOW_HIGHDPI | SDL_WINDOW_RESIZABLE);
 
-    if (win == NULL) {
-        SDL_Log("Error SDL_CreateWindow %s", SDL_GetError());
-        exit(-1);
-    }
+        if (win == NULL) {
+            SDL_Log("Error SDL_CreateWindow %s", SDL_GetError());
+            exit(-1);
+        }
 
-    SDL_SetWindowMinimumSize(win, WINDOW_MIN_WIDTH, WINDOW_MIN_HEIGHT);
+        SDL_SetWindowMinimumSize(win, WINDOW_MIN_WIDTH, WINDOW_MIN_HEIGHT);
 
-    flags |= SDL_RENDERER_ACCELERATED;
-    flags |= SDL_RENDERER_PRESENTVSYNC;
+        flags |= SDL_RENDERER_ACCELERATED;
+        flags |= SDL_RENDERER_PRESENTVSYNC;
 
 #if 0
-    SDL_SetHint(SDL_HINT_RENDER_BATCHING, "1");
-    SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
-    SDL_SetHint(SDL_HINT_RENDER_DRIVER, "opengl");
-    SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
-    SDL_SetHint(SDL_HINT_RENDER_DRIVER, "opengles2");
+        SDL_SetHint(SDL_HINT_RENDER_BATCHING, "1");
+        SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+        SDL_SetHint(SDL_HINT_RENDER_DRIVER, "opengl");
+        SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+        SDL_SetHint(SDL_HINT_RENDER_DRIVER, "opengles2");
 #endif
 
-    renderer = SDL_CreateRenderer(win, -1, flags);
+        renderer = SDL_CreateRenderer(win, -1, flags);
 
-    if (renderer == NULL) {
-        SDL_Log("Error SDL_CreateRenderer %s", SDL_GetError());
-        exit(-1);
-    }
+        if (renderer == NULL) {
+            SDL_Log("Error SDL_CreateRenderer %s", SDL_GetError());
+            exit(-1);
+        }
 
-    /* scale the renderer output for High-DPI displays */
-    {
-        int render_w, render_h;
-        int window_w, window_h;
-        float scale_x, scale_y;
-        SDL_GetRendererOutputSize(renderer, &render_w, &render_h);
-        SDL_GetWindowSize(win, &window_w, &window_h);
-        scale_x = (float)(render_w) / (float)(window_w);
-        scale_y = (float)(render_h) / (float)(window_h);
-        SDL_RenderSetScale(renderer, scale_x, scale_y);
-        font_scale = scale_y;
+        font_scale = DpiUpdateRendererScale(win, renderer);
     }
 
+    LatencyInit(renderer);
     SDL_SetRenderDrawColor(renderer, DEFAULT_BG_COLOR_RED, DEFAULT_BG_COLOR_GREEN, DEFAULT_BG_COLOR_BLUE, 255);
 
     /* GUI */
+    if (alloc_check.arena_kb)
+        nk_sdl_set_arena(alloc_check.arena_kb * 1024);
     ctx = nk_sdl_init(win, renderer);
     /* Load Fonts: if none of these are loaded a default font will be used  */
     /* Load Cursor: if you uncomment cursor loading please hide the cursor */
-    {
-        struct nk_font_atlas* atlas;
-        struct nk_font_config config = nk_font_config(0);
-        struct nk_font* font;
-
-        /* set up the font atlas and add desired font; note that font sizes are
-         * multiplied by font_scale to produce better results at higher DPIs */
-        nk_sdl_font_stash_begin(&atlas);
-        font = nk_font_atlas_add_default(atlas, 13 * font_scale, &config);
-        /*font = nk_font_atlas_add_from_file(atlas, "../../../extra_font/DroidSans.ttf", 14 * font_scale, &config);*/
-        /*font = nk_font_atlas_add_from_file(atlas, "../../../extra_font/Roboto-Regular.ttf", 16 * font_scale, &config);*/
-        /*font = nk_font_atlas_add_from_file(atlas, "../../../extra_font/kenvector_future_thin.ttf", 13 * font_scale, &config);*/
-        /*font = nk_font_atlas_add_from_file(atlas, "../../../extra_font/ProggyClean.ttf", 12 * font_scale, &config);*/
-        /*font = nk_font_atlas_add_from_file(atlas, "../../../extra_font/ProggyTiny.ttf", 10 * font_scale, &config);*/
-        /*font = nk_font_atlas_add_from_file(atlas, "../../../extra_font/Cousine-Regular.ttf", 13 * font_scale, &config);*/
-        nk_sdl_font_stash_end();
-
-        /* this hack makes the font appear to be scaled down to the desired
-         * size and is only necessary when font_scale > 1 */
-        font->handle.height /= font_scale;
-        /*nk_style_load_all_cursors(ctx, atlas->cursors);*/
-        nk_style_set_font(ctx, &font->handle);
-    }
+    DpiInitFonts(ctx, font_scale);
 
     // Fix initial rendering bug regarding hue slider
-    SDL_SetWindowSize(win, WINDOW_WIDTH, WINDOW_HEIGHT - 10);
+    if (win)
+        SDL_SetWindowSize(win, WINDOW_WIDTH, WINDOW_HEIGHT - 10);
+
+    if (!headless.enabled)
+        LibraryStart();
 
     static int popup_active = 0;
 
@@ -104,26 +114,121 @@ int main(int argc, char* argv[])
     {
         /* Input */
         SDL_Event evt;
+        bool had_input = false;
         nk_input_begin(ctx);
-        while (SDL_PollEvent(&evt)) {
+        TraceBegin("idle wait");
+        bool woke = !headless.enabled && IdleWaitEvent(&evt);
+        TraceEnd();
+        if (woke) {
             if (evt.type == SDL_QUIT) goto cleanup;
-            nk_sdl_handle_event(&evt);
+            InputFeed(&evt);
+            had_input = true;
+        }
+        /* the profiled frame starts once the loop is no longer blocked */
+        ProfileSetEnabled(profiler_window);
+        ProfileBeginFrame();
+        {
+            ProfileScope scope(PROFILE_INPUT);
+            TRACE_SCOPE("input");
+            while (SDL_PollEvent(&evt)) {
+                if (evt.type == SDL_QUIT) goto cleanup;
+                InputFeed(&evt);
+                had_input = true;
+            }
+            InputFlush();
+            nk_input_end(ctx);
+        }
+        DpiUpdate(ctx, win, renderer);
+        if (!headless.enabled)
+            WatchUpdate();
+        Uint64 frame_start = SDL_GetPerformanceCounter();
+
+        {
+            ProfileScope scope(PROFILE_MAINGUI);
+            TRACE_SCOPE("maingui");
+            maingui(ctx, win, renderer);
+        }
+        {
+            ProfileScope scope(PROFILE_OVERVIEW);
+            TRACE_SCOPE("overview");
+            overview(ctx);
+            if (profiler_window && !ProfilerWindow(ctx))
+                profiler_window = nk_false;
+            if (memory_window && !MemoryWindow(ctx))
+                memory_window = nk_false;
+            if (browser_window && !BrowserWindow(ctx, renderer))
+                browser_window = nk_false;
+            WatchErrorWindow(ctx);
+        }
+
+        /* headless runs render every frame, as fast as possible */
+        bool pace = !headless.enabled && (render_on_change || idle_mode);
+        bool changed = pace ? nk_sdl_frame_changed() : true;
+        /* a font re-bake or thumbnails in the works count as input, so they are not held up by an idle wait */
+        IdleEndFrame(had_input || nk_sdl_font_rebaking() || BrowserBusy(), changed);
+
+        if (pace && render_on_change && !changed) {
+            /* nothing moved since the last present, keep it on screen */
+            nk_sdl_skip_frame();
+            LatencyFrameSkipped();
+            SDL_Delay(IDLE_FRAME_DELAY_MS);
+            continue;
         }
-        nk_input_end(ctx);
 
-        maingui(ctx, win, renderer);
-        overview(ctx);
         SDL_RenderClear(renderer);
 
+        TraceBegin("render");
         nk_sdl_render(NK_ANTI_ALIASING_ON);
+        TraceEnd();
+        nk_sdl_report_frame_time((float)((SDL_GetPerformanceCounter() - frame_start) * 1000.0 / SDL_GetPerformanceFrequency()));
+        if (profiler.enabled) {
+            struct nk_sdl_render_stats render_stats;
+            nk_sdl_render_stats(&render_stats);
+            ProfileAdd(PROFILE_CONVERT, render_stats.convert_ms);
+            ProfileAdd(PROFILE_DRAW, render_stats.draw_ms);
+        }
+
+        {
+            ProfileScope scope(PROFILE_PRESENT);
+            TRACE_SCOPE("present");
+            SDL_RenderPresent(renderer);
+        }
+        LatencyPresented(pipelined);
+        ProfileEndFrame();
+        AllocCheckEndFrame();
 
-        SDL_RenderPresent(renderer);
+        if (headless.enabled && !HeadlessEndFrame(renderer))
+            break;
     }
 
 cleanup:
+    if (render_on_change && !headless.enabled) {
+        struct nk_sdl_frame_stats frames;
+        nk_sdl_frame_stats(&frames);
+        SDL_Log("render-on-change: %lu frames rendered, %lu skipped", frames.rendered, frames.skipped);
+    }
+    if (idle_mode && !headless.enabled)
+        IdleReport();
+    if (pipelined) {
+        struct nk_sdl_pipeline_stats pipe_stats;
+        nk_sdl_pipeline_stats(NULL, &pipe_stats);
+        SDL_Log("pipeline: avg build %.3f ms, snapshot %.3f ms, convert %.3f ms (worker), wait %.3f ms, submit %.3f ms",
+            pipe_stats.build_ms, pipe_stats.snapshot_ms, pipe_stats.convert_ms, pipe_stats.wait_ms, pipe_stats.submit_ms);
+    }
+    if (headless.enabled)
+        MemoryReport();
+    LatencyReport();
+    bool allocs_ok = AllocCheckReport();
+    WatchShutdown();
+    BrowserShutdown();
+    LibraryShutdown();
     nk_sdl_shutdown();
+    TraceShutdown();
     SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(win);
+    if (headless.enabled)
+        HeadlessShutdown();
+    else
+        SDL_DestroyWindow(win);
     SDL_Quit();
-    return 0;
+    return headless.enabled && !allocs_ok ? 1 : 0;
 }
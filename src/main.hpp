@@ -41,7 +41,6 @@
 // Algorithms and Utilities:
 #include <algorithm>
 #include <functional>
-#include <regex>
 #include <cmath>
 #include <math.h>
 #include <iomanip>
@@ -49,8 +48,11 @@
 
 // String and Character Manipulation
 #include <cstring>
+#include <charconv>
+#include <string_view>
 #include <sstream>
 
 #include "tinyfd/tinyfiledialogs.h"
+#include "common/trace.hpp"
 #include "io/portini.h"
 #include "gui/gui.hpp"